@@ -1,507 +1,6813 @@
+#define _POSIX_C_SOURCE 200809L // getline, mkdtemp, pthread_barrier_t: il file non dipende dal dialetto di default del compilatore
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#define ARENA_BLOCK_SIZE 65536       // dimensione minima di un blocco di memoria dell'arena
+#define ARENA_ALIGNMENT 16
+#define KERNEL_TABLE_INITIAL_SIZE 64 // potenza di 2
+#define SYMBOL_TABLE_INITIAL_SIZE 64 // potenza di 2
+#define KERNEL_MAP_SHARDS 64         // sotto-tabelle con lock indipendente della mappa concorrente dei kernel
+#define FRONTIER_CHUNK 8             // stati della frontiera prelevati per volta da un thread
+
+// codifica di un item LR(0) in una parola a 32 bit: | kernel (1) | produzione (20) | marker (11) |
+#define ITEM_MARKER_BITS 11
+#define ITEM_PRODUCTION_BITS 20
+#define ITEM_KERNEL_FLAG 0x80000000u
+#define ITEM_MARKER_MASK ((1u << ITEM_MARKER_BITS) - 1)
+
+#define EPSILON "~"  // il simbolo specificato e' un alias per il carattere '\epsilon'
+#define NO_SYMBOL -1 // terminatore del body di una produzione
+#define END_OF_INPUT "$" // terminale di fine input, utilizzato dalle tabelle di parsing
 
-#define MAX_GRAMMAR_PRODUCTIONS_NUMBER 50
-#define MAX_PRODUCTION_BODY_LENGTH 50
-#define PRODUCTION_LENGTH 55
-#define MAX_AUTOMA_STATES_COUNT 100
-#define MAX_STATE_ITEMS 50
+// codifica di una entry della tabella ACTION: | argomento | tipo (2 bit) |
+#define ACTION_ERROR 0
+#define ACTION_SHIFT 1
+#define ACTION_REDUCE 2
+#define ACTION_ACCEPT 3
+#define EMPTY_ENTRY -1  // entry vuota nelle tabelle compresse
 
-#define EPSILON '~'  // il carattere specificato e' un alias per il carattere '\epsilon'
+#define CACHE_MAGIC "LR0CACHE"
+#define CACHE_VERSION 1
+#define CACHE_BYTE_ORDER 0x01020304u    // per riconoscere una cache scritta su una macchina con endianness diversa
+
+#define TOKEN_BUFFER_SIZE 65536         // byte letti per volta dall'input del parser
+#define OUTPUT_BUFFER_SIZE (1 << 20)    // buffer dello stream su cui viene scritto l'automa
+#define PARSER_STACK_INITIAL_SIZE 256
 
 typedef enum { false, true } bool;
 typedef enum { normal, accept, final } state_type;
+typedef enum { lr0_tables, slr_tables, lalr_tables } table_kind;
+typedef enum { human_output, json_output, dot_output, binary_output } output_format;
+typedef enum { no_recursion, left_recursion, right_recursion, mixed_recursion } recursion_shape;
+
+/**
+* Arena di memoria: tutta la memoria di grammatica e automa viene allocata a blocchi e liberata in un colpo solo
+* con arenaFree. L'arena non restituisce mai memoria al sistema prima della arenaFree, quindi la memoria
+* riservata coincide con il picco di memoria utilizzata.
+*/
+struct arena_block {
+    struct arena_block* next;
+    size_t size;
+    size_t used;
+    unsigned char* data;
+};
+
+struct arena {
+    struct arena_block* head;
+    struct arena_block* spare;  // blocchi liberati da arenaReset, riutilizzati prima di richiederne di nuovi
+    size_t reserved_bytes;  // byte richiesti al sistema (picco di memoria)
+    size_t used_bytes;      // byte effettivamente assegnati alle allocazioni
+};
+
+/**
+* Tabella dei simboli: associa ad ogni nome di simbolo (terminale o non terminale, anche di piu' caratteri)
+* un id intero denso. Dopo finalizeGrammar i terminali occupano gli id [0, terminals_count) e i non terminali
+* gli id [terminals_count, symbols_count), in modo che transizioni e tabelle siano indicizzabili direttamente.
+*/
+struct symbol_table {
+    char** names;
+    int symbols_count;
+    int symbols_capacity;
+    int terminals_count;
+
+    int* buckets;       // tabella hash nome -> id, -1 se il bucket e' vuoto
+    int buckets_size;   // potenza di 2
+
+    bool multi_character;  // se true i simboli sono parole separate da spazi, altrimenti singoli caratteri
+};
 
 struct production {
-    char driver;
-    char body[MAX_PRODUCTION_BODY_LENGTH];
+    int driver;
+    int* body;          // simboli del body terminati da NO_SYMBOL, vuoto per le epsilon produzioni
+    int body_length;
     int production_id; // utilizzato per controllare velocemente se una produzione e' uguale ad un altra senza controllare body e driver
 };
 
-struct lr0_item {
-    struct production prod;
+struct grammar {
+    struct production* productions;
+    int productions_count;
+    int productions_capacity;
+
+    struct symbol_table symbols;
+
+    // produzioni raggruppate per driver (costruite da finalizeGrammar): le produzioni del non terminale N
+    // sono nonterminal_productions[nonterminal_first_production[N] .. nonterminal_first_production[N+1])
+    int* nonterminal_first_production;
+    int* nonterminal_productions;
+
+    int end_of_input;   // id del terminale di fine input
 
-    int marker_position;
-    bool isKernelProduction;  // utilizzata per capire se un item fa parte del kernel
+    int* body_buffer;   // body della produzione in lettura, riutilizzato da tutte le produzioni
+    int body_buffer_capacity;
+
+    struct arena* arena;
 };
 
+/**
+* Un item LR(0) e' una singola parola che contiene l'indice della produzione nella tabella delle produzioni
+* della grammatica, la posizione del marker e il flag che indica se l'item fa parte del kernel.
+* Due item sono uguali (a meno del flag di kernel) se e solo se lo e' il loro core: il confronto e' un
+* singolo confronto fra interi. L'ordinamento dei core coincide con quello delle coppie (produzione, marker).
+*/
+typedef uint32_t lr0_item;
+
 struct transition {
     int from;
-    char by;
+    int by;
     int destination;
 };
 
+/**
+* Gli array items e transitions sono dimensionati esattamente sul numero di item e di transizioni dello stato:
+* durante l'elaborazione di uno stato si utilizzano i buffer di lavoro dell'automa, che vengono poi copiati
+* nell'arena una volta noto il numero finale di elementi.
+*/
 struct automa_state {
-    struct lr0_item items[MAX_STATE_ITEMS];  
-    struct transition transitions[MAX_AUTOMA_STATES_COUNT];
-    
+    lr0_item* items;
+    struct transition* transitions;
+
     state_type type;
 
     int items_count;
+    int items_capacity;
     int kernel_items_count;
     int transition_count;
+    int transition_capacity;
+};
+
+/**
+* Tabella hash (open addressing con probing lineare) che associa la forma canonica di un kernel,
+* ovvero l'insieme ordinato dei core dei suoi item (coppie production_id, marker_position), all'id dello stato
+* che lo contiene. Permette di sapere in tempo costante atteso se un kernel esiste gia nell'automa.
+* La forma canonica viene calcolata una sola volta, quando lo stato viene inserito, e conservata nel bucket.
+* La tabella raddoppia quando e' piena per meta'.
+*/
+struct kernel_table {
+    int* state_ids;         // -1 se il bucket e' vuoto
+    unsigned int* hashes;
+    lr0_item** kernels;     // forma canonica del kernel dello stato (kernel_items_count core ordinati)
+    int size;               // potenza di 2
+    int count;
+};
+
+/**
+* Formato della cache binaria dell'automa (--cache): header, array degli stati, degli item e delle transizioni.
+* Tutti i riferimenti sono offset dall'inizio del file, quindi il file puo' essere mappato in sola lettura a qualsiasi
+* indirizzo e condiviso tra processi; item e transizioni vengono utilizzati direttamente dalla memoria mappata.
+*/
+struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t grammar_hash;
+    uint32_t productions_count;
+    uint32_t symbols_count;
+    uint32_t states_count;
+    uint32_t reserved;
+    uint64_t items_count;
+    uint64_t transitions_count;
+    uint64_t states_offset;
+    uint64_t items_offset;
+    uint64_t transitions_offset;
+    uint64_t file_size;
+};
+
+struct cache_state {
+    uint64_t items_first;       // indice del primo item nell'array degli item
+    uint64_t transitions_first; // indice della prima transizione nell'array delle transizioni
+    uint32_t items_count;
+    uint32_t kernel_items_count;
+    uint32_t transition_count;
+    uint32_t type;
+};
+
+/**
+* Modifica della grammatica letta da applyGrammarDiff: corrispondenza tra i vecchi e i nuovi id di produzioni e
+* simboli e driver delle produzioni aggiunte o rimosse (con i nuovi id)
+*/
+struct grammar_diff {
+    int* production_map;        // nuovo id di ogni vecchia produzione, -1 se rimossa
+    int old_productions_count;
+    int* symbol_map;            // nuovo id di ogni vecchio simbolo
+    int old_symbols_count;
+    bool* affected_drivers;     // per ogni simbolo (nuovo id): driver di una produzione aggiunta o rimossa
+    int added;
+    int removed;
+};
+
+// esito di updateAutomaIncremental
+struct incremental_report {
+    int rebuilt_states;         // stati esistenti ricostruiti
+    int new_states;             // stati creati dall'aggiornamento
+    int removed_states;         // stati non piu' raggiungibili, eliminati
+    int renumbered_states;      // stati esistenti spostati nel numero di uno stato eliminato
+};
+
+/**
+* Statistiche della generazione raccolte con --stats: tempo per fase e contatori delle operazioni su item e kernel.
+* La raccolta avviene solo se automa->stats non e' NULL, quindi senza --stats il costo e' un confronto per chiamata.
+*/
+struct generation_stats {
+    double grammar_seconds;         // lettura e normalizzazione della grammatica (readGrammar, finalizeGrammar)
+    double construction_seconds;    // generateAutomaChar
+    double closure_seconds;         // computeClosure
+    double kernel_lookup_seconds;   // getKernelEqualTo (o mappa concorrente dei kernel con -j)
+    double incremental_seconds;     // applicazione delle modifiche con --edit e aggiornamento dell'automa
+    double output_seconds;          // scrittura dell'automa (writeAutoma)
+
+    long closure_calls;
+    long closure_insertions;        // item aggiunti dalle closure
+    long closure_duplicates;        // item di closure scartati perche' gia presenti nel kernel
+    long kernel_insertions;         // item aggiunti ai kernel dei nuovi stati
+    long kernel_duplicates;         // item scartati da addItemToKernel perche' gia presenti
+    long kernel_comparisons;        // confronti tra un kernel candidato e quello di uno stato esistente
+    long kernel_lookup_hits;        // ricerche di un kernel gia presente nell'automa
+    long kernel_lookup_misses;      // ricerche concluse con la creazione di un nuovo stato
+
+    const char* cache;              // esito della ricerca nella cache: "none", "hit" oppure "miss"
+};
+
+/**
+* Conflitto in uno stato dell'automa: shift/reduce tra l'item di riduzione "reduce" e gli shift sui terminali
+* "terminals", oppure reduce/reduce tra "reduce" e "other_reduce" sui terminali comuni dei loro lookahead
+*/
+struct conflict {
+    int state;
+    bool reduce_reduce;
+    lr0_item reduce;
+    lr0_item other_reduce;
+    uint64_t* terminals;
+};
+
+/**
+* Analisi dei conflitti: per ogni stato il bitset dei terminali con uno shift viene confrontato con i lookahead
+* degli item di riduzione (tutti i terminali per LR(0), FOLLOW del driver per SLR, lookahead LALR(1)). Con LR(0) e
+* SLR i lookahead non dipendono dall'automa, quindi gli stati vengono controllati durante la costruzione.
+*/
+struct conflict_analysis {
+    table_kind kind;
+    bool fail_fast;             // interrompe la costruzione al primo stato con conflitti
+    int words;
+
+    uint64_t* follow;           // FOLLOW dei non terminali (SLR)
+    uint64_t* lalr_sets;        // lookahead LALR(1) e relativi offset per stato, calcolati ad automa completo
+    int* first_reduction;
+    uint64_t* all_terminals;    // lookahead delle riduzioni LR(0)
+    uint64_t* end_of_input;     // lookahead dell'item K -> S.
+    uint64_t* scratch_shift;    // terminali con uno shift nello stato in esame
+    uint64_t* scratch_reduced;  // unione dei lookahead delle riduzioni gia' esaminate nello stato
+    lr0_item* scratch_reductions;
+    uint64_t** scratch_lookaheads;
+    int scratch_reductions_capacity;
+
+    struct conflict* conflicts;
+    int conflicts_count;
+    int conflicts_capacity;
+    int conflicting_states;
+    int checked_states;         // gli stati [0, checked_states) sono gia' stati controllati
+    int first_conflict_state;   // -1 se non ci sono conflitti
+    bool aborted;               // costruzione interrotta da fail_fast
+
+    struct arena* arena;
+};
+
+struct automa {
+    struct automa_state* states;
+    int states_count;
+    int states_capacity;
+
+    struct kernel_table kernels;
+
+    // buffer di lavoro riutilizzati per lo stato in elaborazione e per il confronto dei kernel
+    lr0_item* scratch_items;
+    int scratch_items_capacity;
+    struct transition* scratch_transitions;
+    int scratch_transitions_capacity;
+    lr0_item* scratch_kernel;
+    int scratch_kernel_capacity;
+
+    // closure precalcolate: per ogni non terminale un bitset sulle produzioni, ovvero sugli item con marker in posizione 0
+    uint64_t* closure_sets;
+    uint64_t* scratch_closure;
+    int closure_set_words;
+
+    // costruzione lazy: closure dei non terminali calcolate al primo utilizzo (NULL con la costruzione completa)
+    uint64_t** lazy_closure_sets;
+    bool* scratch_reached;
+    int* scratch_queue;
+
+    // per lo stato in elaborazione: stato destinazione della transizione tramite ogni simbolo (-1 se assente)
+    int* scratch_symbol_target;
+
+    // per lo stato in elaborazione: item raggruppati per simbolo dopo il marker (vedi groupItemsBySymbol)
+    lr0_item* scratch_grouped_items;
+    int scratch_grouped_capacity;
+    int* scratch_symbol_first;
+    int* scratch_symbol_count;
+    int scratch_symbols_capacity;
+
+    struct generation_stats* stats;  // NULL se le statistiche sono disattivate
+    struct conflict_analysis* conflicts; // NULL se l'analisi dei conflitti e' disattivata
+
+    void* mapped_cache;              // file della cache mappato in memoria (NULL se l'automa non e' stato caricato dalla cache)
+    size_t mapped_cache_size;
+
+    struct grammar* grammar;  // tabella delle produzioni a cui fanno riferimento gli item
+    struct arena* arena;
+};
+
+/**
+* Tabella compressa con row displacement (comb packing): la entry (riga r, colonna c) si trova in
+* values[base[r] + c] se check[base[r] + c] == r, altrimenti la entry e' vuota.
+*/
+struct comb_table {
+    int* base;
+    int* values;
+    int* check;
+    int rows;
+    int length;     // lunghezza degli array values e check
+    int capacity;
+};
+
+/**
+* Relazione su un insieme di nodi in forma compatta: i successori del nodo x sono
+* targets[first[x] .. first[x+1])
+*/
+struct relation {
+    int nodes_count;
+    int* first;
+    int* targets;
+    int edges_count;
+};
+
+/**
+* Insiemi nullable, FIRST e FOLLOW della grammatica: un flag e due bitset sui terminali (words parole ciascuno)
+* per ogni non terminale, indicizzati con nonTerminalIndex
+*/
+struct grammar_sets {
+    int words;
+    bool* nullable;
+    uint64_t* first;
+    uint64_t* follow;
+};
+
+/**
+* Lookahead LALR(1) delle riduzioni. Le riduzioni dello stato q sono i suoi item completi, nell'ordine in cui
+* compaiono tra gli item dello stato: la riduzione r ha il bitset sui terminali sets[(first_reduction[q] + r) * words]
+*/
+struct lalr_lookaheads {
+    int* first_reduction;   // states_count + 1 offset
+    int reductions_count;
+    uint64_t* sets;
+    int words;
+
+    int nonterminal_transitions;    // nodi delle relazioni reads e includes
+    int reads_edges;
+    int includes_edges;
+};
+
+/**
+* Tabelle ACTION e GOTO in forma densa e compressa.
+* ACTION[s][t] contiene una entry codificata (vedi ACTION_*), GOTO[s][N] lo stato destinazione oppure EMPTY_ENTRY.
+*/
+struct parse_tables {
+    table_kind kind;
+    int states_count;
+    int terminals_count;
+    int nonterminals_count;
+
+    int* action;            // states_count x terminals_count
+    int* goto_table;        // states_count x nonterminals_count
+    int conflicts;          // entry con piu' azioni possibili (risolte preferendo lo shift e la produzione con id minore)
+
+    // forme compresse
+    int* default_reduction; // per ogni stato la riduzione piu' frequente (entry ACTION) oppure ACTION_ERROR
+    struct comb_table action_comb;          // ACTION compressa senza riduzioni di default
+    struct comb_table action_default_comb;  // ACTION compressa dopo aver rimosso le riduzioni di default
+    struct comb_table goto_comb;
+
+    // righe delle forme compresse usate da ogni stato: se le righe sono condivise gli stati con righe identiche
+    // usano la stessa riga, altrimenti lo stato s usa la riga s
+    int* action_row;
+    int* goto_row;
+    bool shared_action_rows;
+    bool shared_goto_rows;
+};
+
+/**
+* Risultato di optimizeParseTables: stati e byte delle tabelle compresse (con riduzioni di default) prima e dopo
+*/
+struct table_optimization {
+    int states_before;
+    int states_after;
+    int refinement_rounds;  // iterazioni del raffinamento della partizione degli stati
+    int action_rows;        // righe ACTION e GOTO memorizzate nelle tabelle compresse
+    int goto_rows;
+    size_t bytes_before;
+    size_t bytes_after;
+};
+
+/**
+* Lettore incrementale dei token in input al parser: l'input viene letto a blocchi di TOKEN_BUFFER_SIZE byte.
+* Con simboli di un carattere ogni carattere diverso da uno spazio e' un token, con --multichar i token sono
+* parole separate da spazi. Nessuna allocazione per token: il buffer della parola cresce solo se necessario.
+*/
+struct token_reader {
+    FILE* source;
+    char buffer[TOKEN_BUFFER_SIZE];
+    int length;
+    int position;
+
+    char* word;             // parola corrente (modalita' multichar)
+    int word_capacity;
+    int char_terminal[256]; // terminale associato ad ogni carattere (modalita' a un carattere), NO_SYMBOL se assente
+
+    long tokens_read;
+    struct grammar* grammar;
+    struct arena* arena;
+};
+
+/**
+* Parser LR guidato dalle tabelle compresse. Lo stack degli stati e' preallocato e raddoppia quando e' pieno.
+*/
+struct lr_parser {
+    struct parse_tables* tables;
+    int* reduce_length;     // per ogni produzione la lunghezza del body
+    int* reduce_driver;     // per ogni produzione l'indice del non terminale driver
+
+    int* stack;
+    int stack_capacity;
+    int depth;
+
+    struct arena* arena;
+};
+
+/**
+* Parser LR(0) o SLR che costruisce l'automa caratteristico su richiesta: all'avvio esiste solo lo stato 0 e la
+* closure e le transizioni di uno stato vengono calcolate, una sola volta, la prima volta che il parser lo raggiunge.
+* Gli stati espansi, nell'ordine di espansione, formano il profilo degli accessi.
+*/
+struct lazy_parser {
+    struct automa* automa;
+    struct lr_parser parser;    // stack e lunghezza/driver delle produzioni (senza tabelle)
+    table_kind kind;            // lr0_tables oppure slr_tables
+    struct grammar_sets sets;   // FOLLOW per le riduzioni SLR
+
+    bool* expanded;             // per ogni stato: closure e transizioni gia' calcolate
+    int expanded_capacity;
+    int* expansion_order;
+    int expanded_count;
+    int expansion_order_capacity;
+    int warmed_states;          // stati espansi dal profilo prima del parsing
+};
+
+/**
+* Mappa concorrente kernel -> stato utilizzata dalla costruzione parallela: la mappa e' divisa in KERNEL_MAP_SHARDS
+* tabelle hash (probing lineare) ognuna protetta da un proprio mutex, selezionata dai bit alti dell'hash del kernel.
+* Ogni entry contiene direttamente il kernel canonico, in modo da non dipendere dall'array degli stati che cresce
+* solo tra un livello e l'altro della visita.
+*/
+struct kernel_map_entry {
+    lr0_item* kernel;       // core degli item del kernel in ordine crescente
+    unsigned int hash;
+    int size;
+    int state_id;           // -1 se la entry e' vuota
+};
+
+struct kernel_map_shard {
+    pthread_mutex_t lock;
+    struct kernel_map_entry* entries;
+    int size;               // potenza di 2
+    int count;
+};
+
+// stato creato da un worker durante un livello, inserito nell'array degli stati alla fine del livello
+struct created_state {
+    int id;
+    lr0_item* kernel;
+    int size;
+};
+
+struct construction_worker {
+    pthread_t thread;
+    struct parallel_construction* shared;
+    struct automa local;    // buffer di lavoro del worker (closure, kernel, transizioni)
+    struct arena arena;
+    struct generation_stats stats;
+    struct created_state* created;
+    int created_count;
+    int created_capacity;
+};
+
+/**
+* Stato condiviso della costruzione parallela. L'automa viene visitato per livelli: i worker prelevano a blocchi
+* gli stati della frontiera [frontier_begin, frontier_end) tramite un contatore atomico e registrano i nuovi kernel
+* nella mappa concorrente, che assegna gli id con un secondo contatore atomico.
+*/
+struct parallel_construction {
+    struct automa* automa;
+    struct kernel_map_shard shards[KERNEL_MAP_SHARDS];
+    struct construction_worker* workers;
+    int workers_count;
+
+    pthread_barrier_t level_start;
+    pthread_barrier_t level_end;
+    bool done;
+
+    int frontier_begin;
+    int frontier_end;
+    atomic_int next_frontier;
+    atomic_int next_state_id;
+};
+
+/**
+* Grammatica della modalita' batch con il risultato della sua generazione
+*/
+struct batch_entry {
+    char* path;
+    char* start_symbol;     // NULL se non e' stato possibile ricavarlo dal file
+    const char* error;      // NULL se la generazione e' riuscita
+    int productions;
+    int states;
+    int conflicts;
+    bool aborted;           // costruzione interrotta al primo conflitto (--fail-fast)
+    double seconds;
+};
+
+/**
+* Elenco condiviso delle grammatiche del batch: i worker prelevano la prossima grammatica con un contatore atomico
+*/
+struct batch_job {
+    struct batch_entry* entries;
+    int entries_count;
+    const char* output_directory;   // NULL: nessun file di output per grammatica
+    bool multi_character;
+    bool check_conflicts;
+    table_kind conflicts_kind;
+    bool fail_fast;
+    atomic_int next_entry;
+};
+
+struct batch_worker {
+    struct batch_job* job;
+    struct arena arena;     // azzerata con arenaReset prima di ogni grammatica
+    pthread_t thread;
+};
+
+/**
+* Parametri del generatore di grammatiche sintetiche utilizzato dal benchmark di scalabilita'
+*/
+struct synthetic_options {
+    int sizes[32];              // numero di non terminali di ogni grammatica della serie
+    int sizes_count;
+    int productions;            // produzioni per non terminale
+    int body_length;            // lunghezza massima del body (la lunghezza e' scelta in [1, body_length])
+    int terminals;
+    double epsilon_density;     // probabilita' che una produzione sia una epsilon produzione
+    double nonterminal_density; // probabilita' che un simbolo del body sia un non terminale
+    recursion_shape recursion;
+    uint32_t seed;
+    int repetitions;
 };
 
-bool isNonTerminal(char val){
-    if (val >= 'A' && val <= 'Z'){
-        return true;
+bool linearKernelLookup = false;     // se true si utilizza la ricerca lineare dei kernel (utilizzato dai benchmark)
+int constructionThreads = 1;         // thread utilizzati da generateAutomaChar (opzione -j)
+struct generation_stats generationStats; // statistiche raccolte con --stats
+
+/**
+* Alloca "size" byte dall'arena, richiedendo un nuovo blocco al sistema se quello corrente e' pieno
+*/
+void* arenaAlloc(struct arena* arena, size_t size){
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if (arena->head == NULL || arena->head->used + size > arena->head->size){
+        // primo blocco di riserva abbastanza grande
+        struct arena_block** spare = &arena->spare;
+        while (*spare != NULL && (*spare)->size < size){
+            spare = &(*spare)->next;
+        }
+        if (*spare != NULL){
+            struct arena_block* block = *spare;
+            *spare = block->next;
+            block->next = arena->head;
+            arena->head = block;
+
+            void* ptr = block->data;
+            block->used = size;
+            arena->used_bytes += size;
+            return ptr;
+        }
+
+        size_t blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        struct arena_block* block = malloc(sizeof(struct arena_block));
+        if (block != NULL){
+            block->data = malloc(blockSize);
+        }
+        if (block == NULL || block->data == NULL){
+            fprintf(stderr, "Memoria esaurita: impossibile allocare %zu byte\n", blockSize);
+            exit(1);
+        }
+
+        block->size = blockSize;
+        block->used = 0;
+        block->next = arena->head;
+        arena->head = block;
+        arena->reserved_bytes += blockSize + sizeof(struct arena_block);
+    }
+
+    void* ptr = arena->head->data + arena->head->used;
+    arena->head->used += size;
+    arena->used_bytes += size;
+    return ptr;
+}
+
+/**
+* Ridimensiona un'allocazione dell'arena. Se l'allocazione e' l'ultima del blocco corrente e c'e' spazio
+* viene estesa sul posto, altrimenti viene copiata in una nuova allocazione
+*/
+void* arenaGrow(struct arena* arena, void* ptr, size_t oldSize, size_t newSize){
+    size_t alignedOld = (oldSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    size_t alignedNew = (newSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    struct arena_block* head = arena->head;
+
+    if (ptr != NULL && head != NULL && (unsigned char*)ptr + alignedOld == head->data + head->used && head->used - alignedOld + alignedNew <= head->size){
+        head->used += alignedNew - alignedOld;
+        arena->used_bytes += alignedNew - alignedOld;
+        return ptr;
+    }
+
+    void* newPtr = arenaAlloc(arena, newSize);
+    if (ptr != NULL){
+        memcpy(newPtr, ptr, oldSize);
+    }
+    return newPtr;
+}
+
+/**
+* Garantisce che l'array "*array" (allocato nell'arena) possa contenere almeno "required" elementi,
+* raddoppiandone la capacita' se necessario
+*/
+void ensureCapacity(struct arena* arena, void** array, int* capacity, int required, size_t elementSize){
+    if (required <= *capacity){
+        return;
+    }
+
+    int newCapacity = *capacity > 0 ? *capacity : 4;
+    while (newCapacity < required){
+        newCapacity *= 2;
+    }
+    *array = arenaGrow(arena, *array, *capacity * elementSize, newCapacity * elementSize);
+    *capacity = newCapacity;
+}
+
+/**
+* Ritorna il picco di memoria (in byte) richiesta al sistema dall'arena
+*/
+size_t arenaPeakBytes(struct arena* arena){
+    return arena->reserved_bytes;
+}
+
+/**
+* Restituisce il tempo corrente in secondi (clock monotono), utilizzato dai benchmark e dalle statistiche
+*/
+double currentTimeSeconds(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+* Trasferisce tutti i blocchi dell'arena "from" nell'arena "to", che li liberera' con la propria arenaFree.
+* I blocchi vengono inseriti dopo il blocco corrente di "to", che resta quello in cui avvengono le allocazioni.
+*/
+void arenaAdopt(struct arena* to, struct arena* from){
+    if (from->head == NULL){
+        return;
+    }
+
+    struct arena_block* last = from->head;
+    while (last->next != NULL){
+        last = last->next;
+    }
+    if (to->head == NULL){
+        to->head = from->head;
+    }else{
+        last->next = to->head->next;
+        to->head->next = from->head;
+    }
+
+    to->reserved_bytes += from->reserved_bytes;
+    to->used_bytes += from->used_bytes;
+    from->head = NULL;
+    from->reserved_bytes = 0;
+    from->used_bytes = 0;
+}
+
+/**
+* Rende di nuovo disponibile tutta la memoria dell'arena senza restituirla al sistema: i blocchi diventano blocchi
+* di riserva per le allocazioni successive. Utilizzata per riutilizzare la stessa arena su piu' grammatiche.
+*/
+void arenaReset(struct arena* arena){
+    struct arena_block* block = arena->head;
+    while (block != NULL){
+        struct arena_block* next = block->next;
+        block->used = 0;
+        block->next = arena->spare;
+        arena->spare = block;
+        block = next;
+    }
+    arena->head = NULL;
+    arena->used_bytes = 0;
+}
+
+void arenaFree(struct arena* arena){
+    arenaReset(arena);
+    struct arena_block* block = arena->spare;
+    while (block != NULL){
+        struct arena_block* next = block->next;
+        free(block->data);
+        free(block);
+        block = next;
+    }
+    arena->spare = NULL;
+    arena->reserved_bytes = 0;
+}
+
+static inline lr0_item makeItem(int productionId, int markerPosition, bool isKernelItem){
+    return (isKernelItem ? ITEM_KERNEL_FLAG : 0) | ((uint32_t)productionId << ITEM_MARKER_BITS) | (uint32_t)markerPosition;
+}
+
+static inline int itemProduction(lr0_item item){
+    return (item & ~ITEM_KERNEL_FLAG) >> ITEM_MARKER_BITS;
+}
+
+static inline int itemMarker(lr0_item item){
+    return item & ITEM_MARKER_MASK;
+}
+
+static inline bool itemIsKernel(lr0_item item){
+    return (item & ITEM_KERNEL_FLAG) != 0;
+}
+
+// core dell'item: produzione e marker senza il flag di kernel
+static inline lr0_item itemCore(lr0_item item){
+    return item & ~ITEM_KERNEL_FLAG;
+}
+
+/**
+* Dopo finalizeGrammar i non terminali sono gli id successivi a quelli dei terminali
+*/
+static inline bool isNonTerminal(struct grammar* grammar, int symbol){
+    return symbol >= grammar->symbols.terminals_count;
+}
+
+static inline int nonTerminalIndex(struct grammar* grammar, int symbol){
+    return symbol - grammar->symbols.terminals_count;
+}
+
+static inline int nonTerminalsCount(struct grammar* grammar){
+    return grammar->symbols.symbols_count - grammar->symbols.terminals_count;
+}
+
+static inline void unionBitset(uint64_t* to, uint64_t* from, int words){
+    for (int w=0; w<words; w++){
+        to[w] |= from[w];
+    }
+}
+
+static inline bool testBit(uint64_t* set, int bit){
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static inline void setBit(uint64_t* set, int bit){
+    set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static inline const char* symbolName(struct grammar* grammar, int symbol){
+    return grammar->symbols.names[symbol];
+}
+
+/**
+* Calcola l'hash FNV-1a del nome di un simbolo
+*/
+unsigned int hashSymbolName(const char* name, int length){
+    unsigned int hash = 2166136261u;
+
+    for (int i=0; i<length; i++){
+        hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void rebuildSymbolBuckets(struct symbol_table* symbols, struct arena* arena, int bucketsSize){
+    symbols->buckets = arenaAlloc(arena, bucketsSize * sizeof(int));
+    symbols->buckets_size = bucketsSize;
+    for (int i=0; i<bucketsSize; i++){
+        symbols->buckets[i] = -1;
+    }
+
+    for (int symbol=0; symbol<symbols->symbols_count; symbol++){
+        const char* name = symbols->names[symbol];
+        unsigned int bucket = hashSymbolName(name, strlen(name)) & (bucketsSize - 1);
+        while (symbols->buckets[bucket] != -1){
+            bucket = (bucket + 1) & (bucketsSize - 1);
+        }
+        symbols->buckets[bucket] = symbol;
+    }
+}
+
+/**
+* Ritorna l'id del simbolo con nome name (di lunghezza length), aggiungendolo alla tabella se non presente
+*/
+int internSymbol(struct grammar* grammar, const char* name, int length){
+    struct symbol_table* symbols = &grammar->symbols;
+
+    unsigned int bucket = hashSymbolName(name, length) & (symbols->buckets_size - 1);
+    while (symbols->buckets[bucket] != -1){
+        const char* candidate = symbols->names[symbols->buckets[bucket]];
+        if (strncmp(candidate, name, length) == 0 && candidate[length] == '\0'){
+            return symbols->buckets[bucket];
+        }
+        bucket = (bucket + 1) & (symbols->buckets_size - 1);
+    }
+
+    int symbol = symbols->symbols_count;
+    ensureCapacity(grammar->arena, (void**)&symbols->names, &symbols->symbols_capacity, symbol + 1, sizeof(char*));
+    symbols->names[symbol] = arenaAlloc(grammar->arena, length + 1);
+    memcpy(symbols->names[symbol], name, length);
+    symbols->names[symbol][length] = '\0';
+    symbols->symbols_count++;
+
+    // raddoppio della tabella hash quando il fattore di carico supera 1/2
+    if (2 * symbols->symbols_count > symbols->buckets_size){
+        rebuildSymbolBuckets(symbols, grammar->arena, symbols->buckets_size * 2);
+    }else{
+        symbols->buckets[bucket] = symbol;
+    }
+
+    return symbol;
+}
+
+/**
+* Ritorna l'id del simbolo con nome name oppure -1 se non esiste
+*/
+int findSymbol(struct grammar* grammar, const char* name){
+    struct symbol_table* symbols = &grammar->symbols;
+
+    unsigned int bucket = hashSymbolName(name, strlen(name)) & (symbols->buckets_size - 1);
+    while (symbols->buckets[bucket] != -1){
+        if (strcmp(symbols->names[symbols->buckets[bucket]], name) == 0){
+            return symbols->buckets[bucket];
+        }
+        bucket = (bucket + 1) & (symbols->buckets_size - 1);
+    }
+    return -1;
+}
+
+/**
+* Elimina dalla tabella i simboli con id >= count, cioe' gli ultimi aggiunti da internSymbol. I loro bucket possono
+* essere svuotati senza ricostruire la tabella: gli altri simboli sono stati inseriti (anche da rebuildSymbolBuckets,
+* in ordine di id) prima di loro, quindi nessuna sequenza di ricerca li attraversa.
+*/
+void truncateSymbolTable(struct symbol_table* symbols, int count){
+    for (int symbol=symbols->symbols_count - 1; symbol >= count; symbol--){
+        const char* name = symbols->names[symbol];
+        unsigned int bucket = hashSymbolName(name, strlen(name)) & (symbols->buckets_size - 1);
+        while (symbols->buckets[bucket] != symbol){
+            bucket = (bucket + 1) & (symbols->buckets_size - 1);
+        }
+        symbols->buckets[bucket] = -1;
+    }
+    symbols->symbols_count = count;
+}
+
+void initGrammar(struct grammar* grammar, struct arena* arena, bool multiCharacterSymbols){
+    memset(grammar, 0, sizeof(struct grammar));
+    grammar->arena = arena;
+    grammar->symbols.multi_character = multiCharacterSymbols;
+    rebuildSymbolBuckets(&grammar->symbols, arena, SYMBOL_TABLE_INITIAL_SIZE);
+    grammar->end_of_input = internSymbol(grammar, END_OF_INPUT, strlen(END_OF_INPUT));
+}
+
+/**
+* Aggiunge alla grammatica la produzione driver -> body (body di bodyLength simboli)
+*/
+void appendProduction(struct grammar* grammar, int driver, int* body, int bodyLength){
+    int productionId = grammar->productions_count;
+    if (productionId >= (1 << ITEM_PRODUCTION_BITS)){
+        fprintf(stderr, "Troppe produzioni: il massimo e' %d\n", 1 << ITEM_PRODUCTION_BITS);
+        exit(1);
+    }
+    if (bodyLength > (int)ITEM_MARKER_MASK){ // il marker deve poter arrivare alla fine del body
+        fprintf(stderr, "Produzione troppo lunga: il massimo e' %d simboli\n", (int)ITEM_MARKER_MASK);
+        exit(1);
+    }
+    ensureCapacity(grammar->arena, (void**)&grammar->productions, &grammar->productions_capacity, productionId + 1, sizeof(struct production));
+
+    struct production* production = &grammar->productions[productionId];
+    production->driver = driver;
+    production->body = arenaAlloc(grammar->arena, (bodyLength + 1) * sizeof(int));
+    memcpy(production->body, body, bodyLength * sizeof(int));
+    production->body[bodyLength] = NO_SYMBOL;
+    production->body_length = bodyLength;
+    production->production_id = productionId;
+
+    grammar->productions_count++;
+}
+
+/**
+* Aggiunge la fresh production K -> startSymbol come produzione 0 della grammatica. Il nome del fresh symbol
+* viene scelto da updateFreshSymbol dopo aver letto tutte le produzioni
+*/
+void addFreshProduction(struct grammar* grammar, const char* startSymbol){
+    int start = internSymbol(grammar, startSymbol, strlen(startSymbol));
+
+    // il fresh symbol e' un simbolo senza nome (non raggiungibile tramite la tabella hash) fino a updateFreshSymbol
+    struct symbol_table* symbols = &grammar->symbols;
+    int freshSymbol = symbols->symbols_count;
+    ensureCapacity(grammar->arena, (void**)&symbols->names, &symbols->symbols_capacity, freshSymbol + 1, sizeof(char*));
+    symbols->names[freshSymbol] = "";
+    symbols->symbols_count++;
+
+    appendProduction(grammar, freshSymbol, &start, 1);
+}
+
+static inline bool isBlank(int c){
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+* Converte in simboli il body compreso tra begin ed end e lo aggiunge alla grammatica come produzione di driver.
+* Con simboli di piu' caratteri i simboli sono parole separate da spazi, altrimenti ogni carattere diverso dallo
+* spazio e' un simbolo; il simbolo ~ indica epsilon e non fa parte del body.
+*/
+void appendProductionText(struct grammar* grammar, int driver, const char* begin, const char* end){
+    bool multiCharacter = grammar->symbols.multi_character;
+    int bodyLength = 0;
+
+    for (const char* symbol = begin; symbol < end; ){
+        if (isBlank(*symbol)){
+            symbol++;
+            continue;
+        }
+
+        const char* symbolEnd = symbol + 1;
+        if (multiCharacter){
+            while (symbolEnd < end && !isBlank(*symbolEnd))
+                symbolEnd++;
+        }
+
+        if (!(symbolEnd - symbol == 1 && *symbol == EPSILON[0])){ // epsilon non e' un simbolo del body
+            ensureCapacity(grammar->arena, (void**)&grammar->body_buffer, &grammar->body_buffer_capacity, bodyLength + 1, sizeof(int));
+            grammar->body_buffer[bodyLength++] = internSymbol(grammar, symbol, symbolEnd - symbol);
+        }
+        symbol = symbolEnd;
+    }
+
+    appendProduction(grammar, driver, grammar->body_buffer, bodyLength);
+}
+
+/*
+* Aggiunge alla grammatica le produzioni di una riga della forma A -> beta1 | beta2 | ... lunga length caratteri,
+* senza copiarla ne' modificarla: driver e body vengono convertiti direttamente in simboli. La riga puo' avere
+* lunghezza e numero di alternative qualsiasi.
+*
+* Parametri:
+*  - grammar : la grammatica in cui inserire le nuove produzioni
+*  - text : la riga da cui leggere le produzioni (non necessariamente terminata da '\0')
+*  - length : numero di caratteri della riga
+*
+* Ritorna:
+*  - true : produzioni inserite con successo
+*  - false : errore, nessuna produzione e' stata inserita in quanto la riga non rispetta lo standard A -> beta
+*/
+bool addProductionText(struct grammar* grammar, const char* text, size_t length){
+    const char* end = text + length;
+
+    // split della produzione in driver e body tramite il simbolo arrow "->"
+    const char* arrow = text;
+    while (arrow + 1 < end && !(arrow[0] == '-' && arrow[1] == '>'))
+        arrow++;
+    if (arrow + 1 >= end){
+        return false;
+    }
+
+    const char* driverStart = text;
+    const char* driverEnd = arrow;
+    while (driverStart < driverEnd && isBlank(*driverStart))
+        driverStart++;
+    while (driverEnd > driverStart && isBlank(driverEnd[-1]))
+        driverEnd--;
+    if (driverStart == driverEnd){
+        return false;
+    }
+    for (const char* c = driverStart; c < driverEnd; c++){
+        if (isBlank(*c)){
+            return false;
+        }
+    }
+    if (!grammar->symbols.multi_character && (driverEnd - driverStart != 1 || !(*driverStart >= 'A' && *driverStart <= 'Z'))){
+        return false;
+    }
+
+    int driver = internSymbol(grammar, driverStart, driverEnd - driverStart);
+
+    // le alternative separate dalla | vengono inserite dall'ultima alla prima, mantenendo la numerazione delle
+    // produzioni delle versioni precedenti (e quindi lo stesso output)
+    const char* alternativeEnd = end;
+    for (const char* c = end; c > arrow + 2; c--){
+        if (c[-1] == '|'){
+            appendProductionText(grammar, driver, c, alternativeEnd);
+            alternativeEnd = c - 1;
+        }
+    }
+    appendProductionText(grammar, driver, arrow + 2, alternativeEnd);
+    return true;
+}
+
+/**
+* Aggiunge alla grammatica le produzioni della stringa new_production, della forma A -> beta1 | beta2 | ...
+*
+* Ritorna: false se la produzione non rispetta lo standard A -> beta
+*/
+bool addProduction(struct grammar* grammar, const char* new_production){
+    return addProductionText(grammar, new_production, strlen(new_production));
+}
+
+/**
+* cambia il fresh symbol della grammatica nel caso in cui vi fosse un conflitto.
+* Con simboli di un carattere si sceglie la prima lettera libera, altrimenti si aggiungono apici allo start symbol
+*/
+void updateFreshSymbol(struct grammar* grammar){
+    struct symbol_table* symbols = &grammar->symbols;
+    int freshSymbol = grammar->productions[0].driver;
+    char* freshSymbols = "KABCDEFGHIJLMNOPQRSTUVWXYZ"; // possibili fresh symbols
+    char* freshName = NULL;
+
+    if (!symbols->multi_character){
+        for (int i=0; freshSymbols[i] != '\0' && freshName == NULL; i++){
+            char candidate[2] = { freshSymbols[i], '\0' };
+            if (findSymbol(grammar, candidate) == -1){ // fresh symbol che non va in conflitto con nessun simbolo
+                freshName = arenaAlloc(grammar->arena, 2);
+                strcpy(freshName, candidate);
+            }
+        }
+    }
+
+    if (freshName == NULL){
+        const char* startName = symbolName(grammar, grammar->productions[0].body[0]);
+        int startLength = strlen(startName);
+        int quotes = 1;
+
+        freshName = arenaAlloc(grammar->arena, startLength + 1);
+        strcpy(freshName, startName);
+        do {
+            freshName = arenaGrow(grammar->arena, freshName, startLength + quotes, startLength + quotes + 1);
+            freshName[startLength + quotes - 1] = '\'';
+            freshName[startLength + quotes] = '\0';
+            quotes++;
+        } while (findSymbol(grammar, freshName) != -1);
+    }
+
+    // aggiorna il nome del driver dell'entry point con il fresh symbol
+    symbols->names[freshSymbol] = freshName;
+    rebuildSymbolBuckets(symbols, grammar->arena, symbols->buckets_size);
+
+}
+
+/**
+* Completa la grammatica dopo la lettura: i simboli che compaiono come driver di almeno una produzione
+* diventano non terminali, gli altri terminali. Gli id vengono rinumerati in modo che i terminali precedano
+* i non terminali (mantenendo l'ordine di prima apparizione) e si costruisce l'indice delle produzioni per driver.
+* La funzione puo' essere richiamata dopo aver modificato le produzioni.
+*
+* Ritorna: per ogni simbolo il nuovo id (indicizzato con l'id precedente)
+*/
+int* finalizeGrammar(struct grammar* grammar){
+    struct symbol_table* symbols = &grammar->symbols;
+    int symbolsCount = symbols->symbols_count;
+
+    bool* isDriver = arenaAlloc(grammar->arena, symbolsCount * sizeof(bool));
+    memset(isDriver, 0, symbolsCount * sizeof(bool));
+    for (int t=0; t<grammar->productions_count; t++){
+        isDriver[grammar->productions[t].driver] = true;
+    }
+
+    int* newId = arenaAlloc(grammar->arena, symbolsCount * sizeof(int));
+    char** names = arenaAlloc(grammar->arena, symbolsCount * sizeof(char*));
+    int nextId = 0;
+    for (int pass=0; pass<2; pass++){ // prima i terminali, poi i non terminali
+        for (int symbol=0; symbol<symbolsCount; symbol++){
+            if (isDriver[symbol] == (pass == 1)){
+                newId[symbol] = nextId;
+                names[nextId++] = symbols->names[symbol];
+            }
+        }
+        if (pass == 0){
+            symbols->terminals_count = nextId;
+        }
+    }
+    symbols->names = names;
+    symbols->symbols_capacity = symbolsCount;
+    rebuildSymbolBuckets(symbols, grammar->arena, symbols->buckets_size);
+    grammar->end_of_input = newId[grammar->end_of_input];
+
+    for (int t=0; t<grammar->productions_count; t++){
+        struct production* production = &grammar->productions[t];
+        production->driver = newId[production->driver];
+        for (int i=0; i<production->body_length; i++){
+            production->body[i] = newId[production->body[i]];
+        }
+    }
+
+    // indice delle produzioni per driver (counting sort sul driver, stabile rispetto all'ordine delle produzioni)
+    int nonTerminals = nonTerminalsCount(grammar);
+    grammar->nonterminal_first_production = arenaAlloc(grammar->arena, (nonTerminals + 1) * sizeof(int));
+    grammar->nonterminal_productions = arenaAlloc(grammar->arena, grammar->productions_count * sizeof(int));
+    memset(grammar->nonterminal_first_production, 0, (nonTerminals + 1) * sizeof(int));
+
+    for (int t=0; t<grammar->productions_count; t++){
+        grammar->nonterminal_first_production[nonTerminalIndex(grammar, grammar->productions[t].driver) + 1]++;
+    }
+    for (int n=0; n<nonTerminals; n++){
+        grammar->nonterminal_first_production[n + 1] += grammar->nonterminal_first_production[n];
+    }
+    int* fill = arenaAlloc(grammar->arena, nonTerminals * sizeof(int));
+    memcpy(fill, grammar->nonterminal_first_production, nonTerminals * sizeof(int));
+    for (int t=0; t<grammar->productions_count; t++){
+        grammar->nonterminal_productions[fill[nonTerminalIndex(grammar, grammar->productions[t].driver)]++] = t;
+    }
+
+    return newId;
+}
+
+/**
+* Stampa il body della produzione; se markerPosition >= 0 stampa anche il marker nella posizione indicata.
+* Con simboli di un carattere i simboli sono stampati uno di seguito all'altro, altrimenti separati da spazi.
+*
+* Ritorna: il numero di caratteri stampati
+*/
+int printBody(FILE* out, struct grammar* grammar, struct production* production, int markerPosition){
+    const char* separator = grammar->symbols.multi_character ? " " : "";
+    int printed = 0;
+
+    if (production->body_length == 0){
+        return fprintf(out, "%s", markerPosition >= 0 ? "." : EPSILON);
+    }
+
+    for (int t=0; t<production->body_length; t++){
+        if (t == markerPosition){
+            printed += fprintf(out, t > 0 ? "%s.%s" : ".%s", separator, separator);
+        }else if (t > 0){
+            printed += fprintf(out, "%s", separator);
+        }
+        printed += fprintf(out, "%s", symbolName(grammar, production->body[t]));
+    }
+
+    if (markerPosition == production->body_length){ // marker in ultima posizione
+        printed += fprintf(out, "%s.", separator);
+    }
+    return printed;
+}
+
+// funzione utilizzata per aggiungere una produzione al kernel di uno stato (inizializza il kernel a partire dallo stato precedente item)
+// ritorna false se l'item era gia presente nel kernel
+bool addItemToKernel(struct arena* arena, struct automa_state* destinationState, lr0_item item){
+    int itemsInDestination = destinationState->items_count;
+
+    // l'item aggiunto avra' il marker spostato in avanti di una posizione
+    lr0_item newItem = makeItem(itemProduction(item), itemMarker(item) + 1, true);
+
+    // controllo che l'item non sia gia presente nel kernel
+    bool alreadyIn = false;
+    for (int i=0; i<itemsInDestination; i++){
+        if (destinationState->items[i] == newItem){
+            alreadyIn = true;
+            break;
+        }
+    }
+
+    if (alreadyIn == false){ // aggiungo solo se non e' gia presente
+        ensureCapacity(arena, (void**)&destinationState->items, &destinationState->items_capacity, itemsInDestination + 1, sizeof(lr0_item));
+        destinationState->items[itemsInDestination] = newItem;
+
+        destinationState->items_count++;
+        destinationState->kernel_items_count++;
+    }
+
+    return !alreadyIn;
+}
+
+/**
+* Ritorna il simbolo che segue il marker nell'item, oppure NO_SYMBOL se il marker e' in ultima posizione
+*/
+static inline int symbolAfterMarker(struct grammar* grammar, lr0_item item){
+    return grammar->productions[itemProduction(item)].body[itemMarker(item)];
+}
+
+
+/**
+* Calcola in closure il bitset di un solo non terminale (vedi computeClosureSets); reached e queue sono buffer
+* di lavoro con un elemento per non terminale
+*/
+void fillClosureSet(struct automa* automa, int nonTerminal, uint64_t* closure, bool* reached, int* queue){
+    struct grammar* grammar = automa->grammar;
+    int nonTerminals = nonTerminalsCount(grammar);
+
+    // visita dei non terminali raggiungibili in prima posizione a partire da nonTerminal
+    int queueHead = 0, queueTail = 0;
+    memset(reached, 0, nonTerminals * sizeof(bool));
+
+    reached[nonTerminal] = true;
+    queue[queueTail++] = nonTerminal;
+    while (queueHead < queueTail){
+        int driver = queue[queueHead++];
+
+        for (int p=grammar->nonterminal_first_production[driver]; p<grammar->nonterminal_first_production[driver + 1]; p++){
+            int t = grammar->nonterminal_productions[p];
+            closure[t / 64] |= (uint64_t)1 << (t % 64);
+
+            int first = grammar->productions[t].body[0];
+            if (first != NO_SYMBOL && isNonTerminal(grammar, first) && !reached[nonTerminalIndex(grammar, first)]){
+                reached[nonTerminalIndex(grammar, first)] = true;
+                queue[queueTail++] = nonTerminalIndex(grammar, first);
+            }
+        }
+    }
+}
+
+/**
+* Precalcola per ogni non terminale N il bitset degli item con marker in posizione 0 che fanno parte della
+* closure di un item con il marker prima di N: le produzioni di N e, ricorsivamente, quelle dei non terminali
+* che compaiono in prima posizione nei body delle produzioni gia incluse.
+*/
+void computeClosureSets(struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+    int words = (grammar->productions_count + 63) / 64;
+    int nonTerminals = nonTerminalsCount(grammar);
+
+    automa->closure_set_words = words;
+    automa->closure_sets = arenaAlloc(automa->arena, nonTerminals * words * sizeof(uint64_t));
+    automa->scratch_closure = arenaAlloc(automa->arena, words * sizeof(uint64_t));
+    memset(automa->closure_sets, 0, nonTerminals * words * sizeof(uint64_t));
+
+    bool* reached = arenaAlloc(automa->arena, nonTerminals * sizeof(bool));
+    int* queue = arenaAlloc(automa->arena, nonTerminals * sizeof(int));
+
+    for (int nonTerminal=0; nonTerminal<nonTerminals; nonTerminal++){
+        fillClosureSet(automa, nonTerminal, &automa->closure_sets[nonTerminal * words], reached, queue);
+    }
+}
+
+/**
+* Prepara le closure dei non terminali per la costruzione lazy: nessuna viene calcolata finche' non serve
+*/
+void initLazyClosureSets(struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+    int nonTerminals = nonTerminalsCount(grammar);
+
+    automa->closure_set_words = (grammar->productions_count + 63) / 64;
+    automa->scratch_closure = arenaAlloc(automa->arena, automa->closure_set_words * sizeof(uint64_t));
+    automa->lazy_closure_sets = arenaAlloc(automa->arena, nonTerminals * sizeof(uint64_t*));
+    memset(automa->lazy_closure_sets, 0, nonTerminals * sizeof(uint64_t*));
+    automa->scratch_reached = arenaAlloc(automa->arena, nonTerminals * sizeof(bool));
+    automa->scratch_queue = arenaAlloc(automa->arena, nonTerminals * sizeof(int));
+}
+
+/**
+* Ritorna la closure del non terminale (indice nonTerminal); nella costruzione lazy viene calcolata al primo utilizzo
+*/
+uint64_t* closureSetOf(struct automa* automa, int nonTerminal){
+    int words = automa->closure_set_words;
+    if (automa->lazy_closure_sets == NULL){
+        return &automa->closure_sets[nonTerminal * words];
+    }
+
+    if (automa->lazy_closure_sets[nonTerminal] == NULL){
+        uint64_t* closure = arenaAlloc(automa->arena, words * sizeof(uint64_t));
+        memset(closure, 0, words * sizeof(uint64_t));
+        fillClosureSet(automa, nonTerminal, closure, automa->scratch_reached, automa->scratch_queue);
+        automa->lazy_closure_sets[nonTerminal] = closure;
+    }
+    return automa->lazy_closure_sets[nonTerminal];
+}
+
+
+/**
+* Calcola la closure del kernel dello stato: e' l'OR dei bitset precalcolati dei non terminali che seguono il
+* marker negli item del kernel, quindi ogni item della closure viene aggiunto una sola volta senza controlli.
+* Gli item della closure sono aggiunti in ordine di produzione.
+*/
+void computeClosure(struct automa* automa, struct automa_state* state){
+    struct grammar* grammar = automa->grammar;
+    int words = automa->closure_set_words;
+    uint64_t* closure = automa->scratch_closure;
+    bool hasClosure = false;
+
+    if (automa->stats != NULL){
+        automa->stats->closure_calls++;
+    }
+
+    memset(closure, 0, words * sizeof(uint64_t));
+    for (int i=0; i<state->kernel_items_count; i++){
+        int nextToDot = symbolAfterMarker(grammar, state->items[i]);
+        if (nextToDot != NO_SYMBOL && isNonTerminal(grammar, nextToDot)){
+            uint64_t* nonTerminalClosure = closureSetOf(automa, nonTerminalIndex(grammar, nextToDot));
+            for (int w=0; w<words; w++){
+                closure[w] |= nonTerminalClosure[w];
+            }
+            hasClosure = true;
+        }
+    }
+    if (!hasClosure){
+        return;
+    }
+
+    // un item del kernel con marker in posizione 0 (solo la fresh production dello stato 0) non va duplicato
+    for (int i=0; i<state->kernel_items_count; i++){
+        if (itemMarker(state->items[i]) == 0){
+            int productionId = itemProduction(state->items[i]);
+            if (automa->stats != NULL && (closure[productionId / 64] >> (productionId % 64)) & 1){
+                automa->stats->closure_duplicates++;
+            }
+            closure[productionId / 64] &= ~((uint64_t)1 << (productionId % 64));
+        }
+    }
+
+    int closureSize = 0;
+    for (int w=0; w<words; w++){
+        closureSize += __builtin_popcountll(closure[w]);
+    }
+    ensureCapacity(automa->arena, (void**)&state->items, &state->items_capacity, state->items_count + closureSize, sizeof(lr0_item));
+    if (automa->stats != NULL){
+        automa->stats->closure_insertions += closureSize;
+    }
+
+    for (int w=0; w<words; w++){
+        uint64_t bits = closure[w];
+        while (bits){
+            int productionId = w * 64 + __builtin_ctzll(bits);
+            state->items[state->items_count++] = makeItem(productionId, 0, false);
+            bits &= bits - 1;
+        }
+    }
+}
+
+int compareItems(const void* a, const void* b){
+    lr0_item x = *(const lr0_item*)a;
+    lr0_item y = *(const lr0_item*)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+* Calcola l'hash FNV-1a della forma canonica (ordinata) di un kernel
+*/
+unsigned int hashKernel(lr0_item* kernel, int kernelSize){
+    unsigned int hash = 2166136261u;
+
+    for (int i=0; i<kernelSize; i++){
+        hash = (hash ^ kernel[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+* Garantisce che i buffer di lavoro dei kernel possano contenere "required" item
+*/
+void ensureKernelScratch(struct automa* automa, int required){
+    if (required > automa->scratch_kernel_capacity){
+        ensureCapacity(automa->arena, (void**)&automa->scratch_kernel, &automa->scratch_kernel_capacity, required, sizeof(lr0_item));
+    }
+}
+
+/**
+* Estrae il kernel dello stato "state" in forma canonica, ovvero i core dei suoi item ordinati
+*
+* Ritorna: il numero di item del kernel
+*/
+int canonicalKernelOfState(struct automa_state* state, lr0_item* kernel){
+    int kernelSize = 0;
+
+    for (int i=0; i<state->items_count; i++){
+        if (itemIsKernel(state->items[i])){
+            kernel[kernelSize++] = itemCore(state->items[i]);
+        }
+    }
+    qsort(kernel, kernelSize, sizeof(lr0_item), compareItems);
+
+    return kernelSize;
+}
+
+void initKernelTable(struct arena* arena, struct kernel_table* table, int size){
+    table->state_ids = arenaAlloc(arena, size * sizeof(int));
+    table->hashes = arenaAlloc(arena, size * sizeof(unsigned int));
+    table->kernels = arenaAlloc(arena, size * sizeof(lr0_item*));
+    table->size = size;
+    table->count = 0;
+    for (int i=0; i<size; i++){
+        table->state_ids[i] = -1;
+    }
+}
+
+void insertIntoKernelTable(struct kernel_table* table, int stateId, unsigned int hash, lr0_item* kernel){
+    unsigned int bucket = hash & (table->size - 1);
+    while (table->state_ids[bucket] != -1){
+        bucket = (bucket + 1) & (table->size - 1);
+    }
+    table->state_ids[bucket] = stateId;
+    table->hashes[bucket] = hash;
+    table->kernels[bucket] = kernel;
+    table->count++;
+}
+
+/**
+* Registra nella tabella il kernel dello stato stateId (il kernel dello stato deve essere completo)
+*/
+void addKernelToTable(struct automa* automa, int stateId){
+    struct kernel_table* table = &automa->kernels;
+
+    // raddoppio della tabella quando il fattore di carico supera 1/2
+    if (2 * (table->count + 1) > table->size){
+        struct kernel_table oldTable = *table;
+        initKernelTable(automa->arena, table, oldTable.size * 2);
+        for (int i=0; i<oldTable.size; i++){
+            if (oldTable.state_ids[i] != -1){
+                insertIntoKernelTable(table, oldTable.state_ids[i], oldTable.hashes[i], oldTable.kernels[i]);
+            }
+        }
+    }
+
+    ensureKernelScratch(automa, automa->states[stateId].kernel_items_count);
+    int kernelSize = canonicalKernelOfState(&automa->states[stateId], automa->scratch_kernel);
+    lr0_item* kernel = arenaAlloc(automa->arena, kernelSize * sizeof(lr0_item));
+    memcpy(kernel, automa->scratch_kernel, kernelSize * sizeof(lr0_item));
+    insertIntoKernelTable(table, stateId, hashKernel(kernel, kernelSize), kernel);
+}
+
+/**
+* Cerca nella tabella dei kernel lo stato con il kernel canonico "kernel" (core ordinati) di hash "hash"
+*
+* Ritorna: l'id dello stato, -1 se nessuno stato ha quel kernel
+*/
+int findKernel(struct automa* automa, lr0_item* kernel, int kernelSize, unsigned int hash){
+    struct kernel_table* table = &automa->kernels;
+
+    // probing lineare a partire dal bucket dell'hash fino al primo bucket vuoto
+    unsigned int bucket = hash & (table->size - 1);
+    while (table->state_ids[bucket] != -1){
+        int t = table->state_ids[bucket];
+
+        if (table->hashes[bucket] == hash && automa->states[t].kernel_items_count == kernelSize){
+            if (automa->stats != NULL){
+                automa->stats->kernel_comparisons++;
+            }
+            if (memcmp(table->kernels[bucket], kernel, kernelSize * sizeof(lr0_item)) == 0){ // trovato
+                return t;
+            }
+        }
+        bucket = (bucket + 1) & (table->size - 1);
+    }
+
+    return -1;
+}
+
+/**
+* Raggruppa gli item dello stato per simbolo dopo il marker: gli item con il simbolo X dopo il marker, nell'ordine in
+* cui compaiono nello stato, sono scratch_grouped_items[scratch_symbol_first[X] .. + scratch_symbol_count[X]).
+* In questo modo il kernel di ogni successore si ricava senza scorrere tutti gli item dello stato per ogni transizione.
+* Al termine dell'espansione i contatori dei simboli utilizzati devono essere riportati a 0.
+*/
+void groupItemsBySymbol(struct automa* automa, struct automa_state* state){
+    struct grammar* grammar = automa->grammar;
+    int symbolsCount = grammar->symbols.symbols_count;
+
+    if (automa->scratch_symbols_capacity < symbolsCount){
+        automa->scratch_symbol_first = arenaAlloc(automa->arena, symbolsCount * sizeof(int));
+        automa->scratch_symbol_count = arenaAlloc(automa->arena, symbolsCount * sizeof(int));
+        memset(automa->scratch_symbol_count, 0, symbolsCount * sizeof(int));
+        automa->scratch_symbols_capacity = symbolsCount;
+    }
+    ensureCapacity(automa->arena, (void**)&automa->scratch_grouped_items, &automa->scratch_grouped_capacity, state->items_count, sizeof(lr0_item));
+
+    // conteggio (negativo finche' il gruppo non ha una posizione), poi assegnazione delle posizioni e riempimento
+    int* count = automa->scratch_symbol_count;
+    for (int i=0; i<state->items_count; i++){
+        int symbol = symbolAfterMarker(grammar, state->items[i]);
+        if (symbol != NO_SYMBOL){
+            count[symbol]--;
+        }
+    }
+
+    int cursor = 0;
+    for (int i=0; i<state->items_count; i++){
+        int symbol = symbolAfterMarker(grammar, state->items[i]);
+        if (symbol == NO_SYMBOL){
+            continue;
+        }
+        if (count[symbol] < 0){
+            automa->scratch_symbol_first[symbol] = cursor;
+            cursor -= count[symbol];
+            count[symbol] = 0;
+        }
+        automa->scratch_grouped_items[automa->scratch_symbol_first[symbol] + count[symbol]++] = state->items[i];
+    }
+}
+
+/**
+* Questa funzione permette di controllare se il kernel generato dallo stato in espansione proseguendo con una
+* transizione tramite "nextSymbol" e' gia presente tra quelli presenti nell'automa caratteristico.
+* Se lo stato e' gia presente si ritorna l'identificativo dello stato.
+* Il kernel candidato viene portato in forma canonica e cercato nella tabella hash dei kernel: il confronto
+* completo fra kernel avviene solo fra kernel con lo stesso hash.
+*
+* Parametri:
+* - automa : l'automa caratteristico finale, contenente la tabella hash dei kernel dei suoi stati e gli item dello
+*            stato in espansione raggruppati per simbolo da groupItemsBySymbol
+* - nextSymbol : il prossimo simbolo della transizione (terminale o non terminale)
+*
+* Ritorna:
+* - id_stato : se si e' trovato uno stato con id stato_id e con kernel uguale gia presente
+* - -1 : se non esiste ancora uno stato con quel kernel
+*/
+int getKernelEqualTo(struct automa* automa, int nextSymbol){
+    int kernelSize = automa->scratch_symbol_count[nextSymbol]; // la dimensione del nuovo kernel effettuando una transizione con nextSymbol
+    lr0_item* group = &automa->scratch_grouped_items[automa->scratch_symbol_first[nextSymbol]];
+
+    ensureKernelScratch(automa, kernelSize);
+    lr0_item* kernelOfState = automa->scratch_kernel;
+
+    // estrai le produzione che faranno parte del kernel del nuovo stato (gli item dello stato in espansione
+    // raggruppati per nextSymbol da groupItemsBySymbol) con il marker gia spostato in avanti
+    for (int i=0; i<kernelSize; i++){
+        kernelOfState[i] = itemCore(group[i]) + 1;
+    }
+    qsort(kernelOfState, kernelSize, sizeof(lr0_item), compareItems);
+
+    return findKernel(automa, kernelOfState, kernelSize, hashKernel(kernelOfState, kernelSize));
+}
+
+/**
+* Versione originale di getKernelEqualTo basata su una scansione lineare di tutti gli stati dell'automa.
+* Non viene piu' utilizzata durante la generazione ma e' mantenuta come riferimento per il benchmark --bench-kernel.
+*/
+int getKernelEqualToLinear(struct automa* automa, int stateId, int nextSymbol){
+    int kernelEqualTo = -1;
+    struct automa_state* state = &automa->states[stateId];
+
+    ensureKernelScratch(automa, state->items_count);
+    lr0_item* kernelOfState = automa->scratch_kernel;
+    int stateIdKernelSize = 0;
+
+    for (int i=0; i<state->items_count; i++){
+        if (symbolAfterMarker(automa->grammar, state->items[i]) == nextSymbol){
+            kernelOfState[stateIdKernelSize++] = itemCore(state->items[i]);
+        }
+    }
+
+    for (int t=0; t<automa->states_count; t++){
+        struct automa_state* other = &automa->states[t];
+
+        if (stateIdKernelSize == other->kernel_items_count){ // affinche' due kernel siano uguali devono avere come minimo lo stesso numero di produzioni
+            bool allEqual = true;
+            if (automa->stats != NULL){
+                automa->stats->kernel_comparisons++;
+            }
+
+            for (int kernelProd=0; kernelProd<stateIdKernelSize; kernelProd++){
+                bool corrispondenza = false;
+                for (int prod=0; prod<other->items_count; prod++){
+                    if (other->items[prod] == ((kernelOfState[kernelProd] + 1) | ITEM_KERNEL_FLAG)){
+                        corrispondenza = true;
+                    }
+                }
+
+                if (corrispondenza == false){
+                    allEqual = false;
+                    break;
+                }
+            }
+
+            if (allEqual == true){
+                kernelEqualTo = t;
+                break;
+            }
+        }
+    }
+
+    return kernelEqualTo;
+}
+
+void initAutoma(struct automa* automa, struct arena* arena){
+    memset(automa, 0, sizeof(struct automa));
+    automa->arena = arena;
+    initKernelTable(arena, &automa->kernels, KERNEL_TABLE_INITIAL_SIZE);
+}
+
+/**
+* Aggiunge un nuovo stato (vuoto) all'automa.
+* Attenzione: l'array degli stati puo' essere riallocato, i puntatori agli stati precedenti non sono piu' validi
+*
+* Ritorna: l'id del nuovo stato
+*/
+int addState(struct automa* automa){
+    int stateId = automa->states_count;
+    ensureCapacity(automa->arena, (void**)&automa->states, &automa->states_capacity, stateId + 1, sizeof(struct automa_state));
+
+    struct automa_state newState = {
+        .items = NULL,
+        .transitions = NULL,
+        .items_count = 0,
+        .items_capacity = 0,
+        .kernel_items_count = 0,
+        .transition_count = 0,
+        .transition_capacity = 0,
+        .type = normal
+    };
+    automa->states[stateId] = newState;
+    automa->states_count++;
+
+    return stateId;
+}
+
+/**
+* Aggiunge una transizione allo stato in elaborazione stateId (che utilizza il buffer di lavoro delle transizioni)
+*/
+void addTransition(struct automa* automa, int stateId, int by, int destination){
+    struct automa_state* state = &automa->states[stateId];
+
+    struct transition newTransition = {
+        .from = stateId,
+        .by = by,
+        .destination = destination
+    };
+
+    ensureCapacity(automa->arena, (void**)&state->transitions, &state->transition_capacity, state->transition_count + 1, sizeof(struct transition));
+    state->transitions[state->transition_count++] = newTransition;
+    automa->scratch_symbol_target[by] = destination;
+}
+
+
+/**
+* Stampa tutte le transizioni dell'automa nello stesso formato e ordine della costruzione seriale
+*/
+void printTransitions(FILE* out, struct automa* automa){
+    for (int state=0; state<automa->states_count; state++){
+        for (int tr=0; tr<automa->states[state].transition_count; tr++){
+            struct transition* transition = &automa->states[state].transitions[tr];
+            fprintf(out, "Tau (%d, %s) = %d \n", transition->from, symbolName(automa->grammar, transition->by), transition->destination);
+        }
+    }
+}
+
+/**
+* Stampa le produzioni della grammatica (sezione GRAMMATICA dell'output)
+*/
+void printGrammar(FILE* out, struct grammar* grammar){
+    fprintf(out, "============== GRAMMATICA ===============\n");
+    for (int i=0; i<grammar->productions_count; i++){
+        fprintf(out, "%s -> ", symbolName(grammar, grammar->productions[i].driver));
+        printBody(out, grammar, &grammar->productions[i], -1);
+        fputc('\n', out);
+    }
+}
+
+/**
+* Stampa gli item di ogni stato dell'automa, segnando gli item del kernel (sezione ITEMS NEGLI STATI dell'output)
+*/
+void printStates(FILE* out, struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+
+    fprintf(out, "=========== ITEMS NEGLI STATI ===========\n");
+    for(int state=0; state<automa->states_count; state++){
+        char* state_type = "";
+        if (automa->states[state].type == accept){
+            state_type = "Stato di accept";
+        }else if(automa->states[state].type == final){
+            state_type = "Stato finale";
+        }
+
+        fprintf(out, "++++++++++ STATO %d %s\n", state, state_type);
+        for(int itemId = 0; itemId < automa->states[state].items_count; itemId++){
+            lr0_item item = automa->states[state].items[itemId];
+            struct production* prod = &grammar->productions[itemProduction(item)];
+            int marker_position = itemMarker(item);
+
+            int printed = fprintf(out, "%s -> ", symbolName(grammar, prod->driver));
+            printed += printBody(out, grammar, prod, marker_position);
+
+            if (itemIsKernel(item)){ // item facente parte del kernel
+                if (printed < 8)
+                    fputc('\t', out);
+                fputs("\t[ K ]", out);
+            }
+
+            fputc('\n', out);
+        }
+
+    }
+}
+
+/////////////////////////////// COSTRUZIONE PARALLELA //////////////////////////////
+
+/**
+* Sotto-tabella della mappa concorrente per un kernel con hash "hash", scelta con i bit alti dell'hash (quelli
+* bassi scelgono il bucket all'interno della sotto-tabella), per qualsiasi valore di KERNEL_MAP_SHARDS
+*/
+static inline struct kernel_map_shard* kernelMapShard(struct parallel_construction* shared, unsigned int hash){
+    return &shared->shards[((uint64_t)hash * KERNEL_MAP_SHARDS) >> 32];
+}
+
+/**
+* Ritorna l'id dello stato con il kernel canonico "kernel" (core ordinati), creandolo se non esiste ancora.
+* Il nuovo stato riceve il primo id libero e viene registrato tra gli stati creati dal worker.
+*/
+int kernelMapGetOrInsert(struct construction_worker* worker, lr0_item* kernel, int kernelSize, unsigned int hash){
+    struct parallel_construction* shared = worker->shared;
+    struct kernel_map_shard* shard = kernelMapShard(shared, hash);
+
+    pthread_mutex_lock(&shard->lock);
+
+    unsigned int bucket = hash & (shard->size - 1);
+    while (shard->entries[bucket].state_id != -1){
+        struct kernel_map_entry* entry = &shard->entries[bucket];
+        if (entry->hash == hash && entry->size == kernelSize){
+            if (worker->local.stats != NULL){
+                worker->local.stats->kernel_comparisons++;
+            }
+            if (memcmp(entry->kernel, kernel, kernelSize * sizeof(lr0_item)) == 0){
+                int stateId = entry->state_id;
+                pthread_mutex_unlock(&shard->lock);
+                if (worker->local.stats != NULL){
+                    worker->local.stats->kernel_lookup_hits++;
+                }
+                return stateId;
+            }
+        }
+        bucket = (bucket + 1) & (shard->size - 1);
+    }
+
+    // nuovo kernel: copia nella memoria del worker e assegnazione dell'id
+    struct kernel_map_entry* entry = &shard->entries[bucket];
+    entry->kernel = arenaAlloc(&worker->arena, kernelSize * sizeof(lr0_item));
+    memcpy(entry->kernel, kernel, kernelSize * sizeof(lr0_item));
+    entry->hash = hash;
+    entry->size = kernelSize;
+    entry->state_id = atomic_fetch_add(&shared->next_state_id, 1);
+    int stateId = entry->state_id;
+    shard->count++;
+    if (worker->local.stats != NULL){
+        worker->local.stats->kernel_lookup_misses++;
+        worker->local.stats->kernel_insertions += kernelSize;
+    }
+
+    // raddoppio della sotto-tabella quando il fattore di carico supera 1/2
+    if (2 * shard->count > shard->size){
+        struct kernel_map_entry* oldEntries = shard->entries;
+        int oldSize = shard->size;
+        shard->size *= 2;
+        shard->entries = arenaAlloc(&worker->arena, shard->size * sizeof(struct kernel_map_entry));
+        for (int i=0; i<shard->size; i++){
+            shard->entries[i].state_id = -1;
+        }
+        for (int i=0; i<oldSize; i++){
+            if (oldEntries[i].state_id != -1){
+                unsigned int b = oldEntries[i].hash & (shard->size - 1);
+                while (shard->entries[b].state_id != -1){
+                    b = (b + 1) & (shard->size - 1);
+                }
+                shard->entries[b] = oldEntries[i];
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    ensureCapacity(&worker->arena, (void**)&worker->created, &worker->created_capacity, worker->created_count + 1, sizeof(struct created_state));
+    struct created_state created = { .id = stateId, .kernel = NULL, .size = kernelSize };
+    created.kernel = arenaAlloc(&worker->arena, kernelSize * sizeof(lr0_item));
+    for (int k=0; k<kernelSize; k++){
+        created.kernel[k] = kernel[k] | ITEM_KERNEL_FLAG;
+    }
+    worker->created[worker->created_count++] = created;
+
+    return stateId;
+}
+
+/**
+* Completa lo stato stateId della frontiera: closure del kernel, transizioni verso gli stati successori (registrati
+* nella mappa concorrente) e tipo dello stato. Gli array definitivi vengono allocati nell'arena del worker.
+*/
+void expandStateParallel(struct construction_worker* worker, int stateId){
+    struct automa* local = &worker->local;
+    struct grammar* grammar = local->grammar;
+    struct automa_state* state = &worker->shared->automa->states[stateId];
+
+    struct automa_state work = *state;
+    ensureCapacity(&worker->arena, (void**)&local->scratch_items, &local->scratch_items_capacity, state->items_count, sizeof(lr0_item));
+    memcpy(local->scratch_items, state->items, state->items_count * sizeof(lr0_item));
+    work.items = local->scratch_items;
+    work.items_capacity = local->scratch_items_capacity;
+    double closureStart = local->stats != NULL ? currentTimeSeconds() : 0;
+    computeClosure(local, &work);
+    if (local->stats != NULL){
+        local->stats->closure_seconds += currentTimeSeconds() - closureStart;
+    }
+    local->scratch_items = work.items;
+    local->scratch_items_capacity = work.items_capacity;
+    groupItemsBySymbol(local, &work);
+
+    int transitionCount = 0;
+    for (int i=0; i<work.items_count; i++){
+        int nextSymbol = symbolAfterMarker(grammar, work.items[i]);
+
+        if (nextSymbol == NO_SYMBOL){ // reducing item
+            work.type = itemProduction(work.items[i]) == 0 ? accept : final;
+            continue;
+        }
+        if (local->scratch_symbol_target[nextSymbol] != -1){
+            continue;
+        }
+
+        int kernelSize = local->scratch_symbol_count[nextSymbol];
+        lr0_item* group = &local->scratch_grouped_items[local->scratch_symbol_first[nextSymbol]];
+        ensureKernelScratch(local, kernelSize);
+        for (int k=0; k<kernelSize; k++){
+            local->scratch_kernel[k] = itemCore(group[k]) + 1;
+        }
+        double lookupStart = local->stats != NULL ? currentTimeSeconds() : 0;
+        qsort(local->scratch_kernel, kernelSize, sizeof(lr0_item), compareItems);
+        int destination = kernelMapGetOrInsert(worker, local->scratch_kernel, kernelSize, hashKernel(local->scratch_kernel, kernelSize));
+        if (local->stats != NULL){
+            local->stats->kernel_lookup_seconds += currentTimeSeconds() - lookupStart;
+        }
+
+        ensureCapacity(&worker->arena, (void**)&local->scratch_transitions, &local->scratch_transitions_capacity, transitionCount + 1, sizeof(struct transition));
+        struct transition newTransition = { .from = stateId, .by = nextSymbol, .destination = destination };
+        local->scratch_transitions[transitionCount++] = newTransition;
+        local->scratch_symbol_target[nextSymbol] = destination;
+    }
+
+    for (int tr=0; tr<transitionCount; tr++){
+        local->scratch_symbol_target[local->scratch_transitions[tr].by] = -1;
+        local->scratch_symbol_count[local->scratch_transitions[tr].by] = 0;
+    }
+
+    // solo il worker che ha prelevato lo stato scrive nella sua entry dell'array degli stati
+    state->items = arenaAlloc(&worker->arena, work.items_count * sizeof(lr0_item));
+    memcpy(state->items, work.items, work.items_count * sizeof(lr0_item));
+    state->items_count = work.items_count;
+    state->items_capacity = work.items_count;
+    state->transitions = arenaAlloc(&worker->arena, transitionCount * sizeof(struct transition));
+    if (transitionCount > 0){
+        memcpy(state->transitions, local->scratch_transitions, transitionCount * sizeof(struct transition));
+    }
+    state->transition_count = transitionCount;
+    state->transition_capacity = transitionCount;
+    state->type = work.type;
+}
+
+void expandFrontier(struct construction_worker* worker){
+    struct parallel_construction* shared = worker->shared;
+
+    for (;;){
+        int begin = atomic_fetch_add(&shared->next_frontier, FRONTIER_CHUNK);
+        if (begin >= shared->frontier_end){
+            break;
+        }
+        int end = begin + FRONTIER_CHUNK < shared->frontier_end ? begin + FRONTIER_CHUNK : shared->frontier_end;
+        for (int stateId=begin; stateId<end; stateId++){
+            expandStateParallel(worker, stateId);
+        }
+    }
+}
+
+void* constructionWorkerMain(void* argument){
+    struct construction_worker* worker = argument;
+    struct parallel_construction* shared = worker->shared;
+
+    for (;;){
+        pthread_barrier_wait(&shared->level_start);
+        if (shared->done){
+            break;
+        }
+        expandFrontier(worker);
+        pthread_barrier_wait(&shared->level_end);
+    }
+    return NULL;
+}
+
+/**
+* Rinumera gli stati costruiti in parallelo in modo che coincidano con quelli della costruzione seriale.
+* La costruzione seriale numera gli stati in ordine di scoperta con una visita in ampiezza a partire dallo stato 0,
+* seguendo le transizioni di ogni stato nell'ordine dei suoi item; il kernel di un nuovo stato ha gli item nell'ordine
+* in cui compaiono nello stato che lo ha scoperto. La visita seguente ricostruisce lo stesso ordine degli item, delle
+* transizioni e degli stati.
+*/
+void canonicalizeStateNumbering(struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+    int statesCount = automa->states_count;
+    int* newId = arenaAlloc(automa->arena, statesCount * sizeof(int));
+    int* order = arenaAlloc(automa->arena, statesCount * sizeof(int)); // coda della visita: order[nuovo id] = vecchio id
+    for (int i=0; i<statesCount; i++){
+        newId[i] = -1;
+    }
+
+    int discovered = 0;
+    newId[0] = discovered;
+    order[discovered++] = 0;
+
+    for (int head=0; head<discovered; head++){
+        struct automa_state* state = &automa->states[order[head]];
+
+        // ordine delle transizioni: ordine di prima comparsa del simbolo dopo il marker negli item dello stato
+        for (int tr=0; tr<state->transition_count; tr++){
+            automa->scratch_symbol_target[state->transitions[tr].by] = state->transitions[tr].destination;
+        }
+        int transitionCount = 0;
+        for (int i=0; i<state->items_count; i++){
+            int symbol = symbolAfterMarker(grammar, state->items[i]);
+            if (symbol == NO_SYMBOL || automa->scratch_symbol_target[symbol] == -1){
+                continue;
+            }
+
+            int destination = automa->scratch_symbol_target[symbol];
+            automa->scratch_symbol_target[symbol] = -1;
+            struct transition ordered = { .from = order[head], .by = symbol, .destination = destination };
+            state->transitions[transitionCount++] = ordered;
+
+            if (newId[destination] == -1){ // nuovo stato: il kernel segue l'ordine degli item di questo stato
+                newId[destination] = discovered;
+                order[discovered++] = destination;
+
+                struct automa_state* destinationState = &automa->states[destination];
+                int k = 0;
+                for (int j=i; j<state->items_count; j++){
+                    if (symbolAfterMarker(grammar, state->items[j]) == symbol){
+                        destinationState->items[k++] = makeItem(itemProduction(state->items[j]), itemMarker(state->items[j]) + 1, true);
+                    }
+                }
+            }
+        }
+    }
+
+    struct automa_state* renumbered = arenaAlloc(automa->arena, statesCount * sizeof(struct automa_state));
+    for (int id=0; id<statesCount; id++){
+        renumbered[id] = automa->states[order[id]];
+        for (int tr=0; tr<renumbered[id].transition_count; tr++){
+            renumbered[id].transitions[tr].from = id;
+            renumbered[id].transitions[tr].destination = newId[renumbered[id].transitions[tr].destination];
+        }
+    }
+    automa->states = renumbered;
+    automa->states_capacity = statesCount;
+
+    // la tabella dei kernel viene ricostruita con i nuovi id
+    initKernelTable(automa->arena, &automa->kernels, KERNEL_TABLE_INITIAL_SIZE);
+    for (int id=0; id<statesCount; id++){
+        addKernelToTable(automa, id);
+    }
+}
+
+/**
+* Costruzione dell'automa con "threads" thread. Gli stati vengono completati per livelli della visita in ampiezza:
+* i thread si dividono dinamicamente la frontiera e i nuovi kernel vengono registrati nella mappa concorrente;
+* alla fine di ogni livello i nuovi stati vengono inseriti nell'array degli stati. Al termine la numerazione viene
+* resa canonica, quindi il risultato coincide con quello della costruzione seriale.
+*/
+int generateAutomaParallel(struct automa* automa, struct grammar* grammar, int threads){
+    struct arena* arena = automa->arena;
+    struct parallel_construction shared;
+    int symbolsCount = grammar->symbols.symbols_count;
+
+    memset(&shared, 0, sizeof(shared));
+    shared.automa = automa;
+    shared.workers_count = threads;
+    shared.workers = arenaAlloc(arena, threads * sizeof(struct construction_worker));
+    memset(shared.workers, 0, threads * sizeof(struct construction_worker));
+    atomic_init(&shared.next_frontier, 0);
+    atomic_init(&shared.next_state_id, 1);
+
+    for (int i=0; i<KERNEL_MAP_SHARDS; i++){
+        pthread_mutex_init(&shared.shards[i].lock, NULL);
+        shared.shards[i].size = KERNEL_TABLE_INITIAL_SIZE;
+        shared.shards[i].entries = arenaAlloc(arena, KERNEL_TABLE_INITIAL_SIZE * sizeof(struct kernel_map_entry));
+        for (int b=0; b<KERNEL_TABLE_INITIAL_SIZE; b++){
+            shared.shards[i].entries[b].state_id = -1;
+        }
+    }
+
+    // stato 0 con il kernel K -> .S , registrato nella mappa
+    int state0 = addState(automa);
+    automa->states[state0].items = arenaAlloc(arena, sizeof(lr0_item));
+    automa->states[state0].items[0] = makeItem(0, 0, true);
+    automa->states[state0].items_count = 1;
+    automa->states[state0].items_capacity = 1;
+    automa->states[state0].kernel_items_count = 1;
+    {
+        lr0_item kernel0 = makeItem(0, 0, false);
+        unsigned int hash = hashKernel(&kernel0, 1);
+        struct kernel_map_shard* shard = kernelMapShard(&shared, hash);
+        struct kernel_map_entry entry = { .kernel = arenaAlloc(arena, sizeof(lr0_item)), .hash = hash, .size = 1, .state_id = state0 };
+        entry.kernel[0] = kernel0;
+        shard->entries[hash & (shard->size - 1)] = entry;
+        shard->count = 1;
+    }
+
+    computeClosureSets(automa);
+    automa->scratch_symbol_target = arenaAlloc(arena, symbolsCount * sizeof(int));
+    for (int symbol=0; symbol<symbolsCount; symbol++){
+        automa->scratch_symbol_target[symbol] = -1;
+    }
+
+    for (int w=0; w<threads; w++){
+        struct construction_worker* worker = &shared.workers[w];
+        worker->shared = &shared;
+        worker->local.grammar = grammar;
+        worker->local.arena = &worker->arena;
+        worker->local.closure_sets = automa->closure_sets;
+        worker->local.closure_set_words = automa->closure_set_words;
+        worker->local.scratch_closure = arenaAlloc(&worker->arena, automa->closure_set_words * sizeof(uint64_t));
+        worker->local.stats = automa->stats != NULL ? &worker->stats : NULL;
+        worker->local.scratch_symbol_target = arenaAlloc(&worker->arena, symbolsCount * sizeof(int));
+        for (int symbol=0; symbol<symbolsCount; symbol++){
+            worker->local.scratch_symbol_target[symbol] = -1;
+        }
+    }
+
+    pthread_barrier_init(&shared.level_start, NULL, threads);
+    pthread_barrier_init(&shared.level_end, NULL, threads);
+    for (int w=1; w<threads; w++){ // il thread chiamante fa da worker 0
+        if (pthread_create(&shared.workers[w].thread, NULL, constructionWorkerMain, &shared.workers[w]) != 0){
+            fprintf(stderr, "Impossibile creare il thread %d\n", w);
+            exit(1);
+        }
+    }
+
+    shared.frontier_begin = 0;
+    shared.frontier_end = 1;
+    while (shared.frontier_begin < shared.frontier_end){
+        atomic_store(&shared.next_frontier, shared.frontier_begin);
+
+        pthread_barrier_wait(&shared.level_start);
+        expandFrontier(&shared.workers[0]);
+        pthread_barrier_wait(&shared.level_end);
+
+        // inserimento degli stati scoperti durante il livello: formano la frontiera successiva
+        int statesCount = atomic_load(&shared.next_state_id);
+        ensureCapacity(arena, (void**)&automa->states, &automa->states_capacity, statesCount, sizeof(struct automa_state));
+        for (int w=0; w<threads; w++){
+            struct construction_worker* worker = &shared.workers[w];
+            for (int c=0; c<worker->created_count; c++){
+                struct created_state* created = &worker->created[c];
+                struct automa_state newState = {
+                    .items = created->kernel,
+                    .transitions = NULL,
+                    .items_count = created->size,
+                    .items_capacity = created->size,
+                    .kernel_items_count = created->size,
+                    .transition_count = 0,
+                    .transition_capacity = 0,
+                    .type = normal
+                };
+                automa->states[created->id] = newState;
+            }
+            worker->created_count = 0;
+        }
+        automa->states_count = statesCount;
+
+        shared.frontier_begin = shared.frontier_end;
+        shared.frontier_end = statesCount;
+    }
+
+    shared.done = true;
+    pthread_barrier_wait(&shared.level_start);
+    for (int w=1; w<threads; w++){
+        pthread_join(shared.workers[w].thread, NULL);
+    }
+    pthread_barrier_destroy(&shared.level_start);
+    pthread_barrier_destroy(&shared.level_end);
+    for (int i=0; i<KERNEL_MAP_SHARDS; i++){
+        pthread_mutex_destroy(&shared.shards[i].lock);
+    }
+
+    // la memoria dei worker (item, transizioni, kernel) passa all'arena dell'automa
+    for (int w=0; w<threads; w++){
+        arenaAdopt(arena, &shared.workers[w].arena);
+    }
+
+    // statistiche dei worker: i tempi sono la somma dei tempi dei singoli thread
+    if (automa->stats != NULL){
+        for (int w=0; w<threads; w++){
+            struct generation_stats* stats = &shared.workers[w].stats;
+            automa->stats->closure_seconds += stats->closure_seconds;
+            automa->stats->kernel_lookup_seconds += stats->kernel_lookup_seconds;
+            automa->stats->closure_calls += stats->closure_calls;
+            automa->stats->closure_insertions += stats->closure_insertions;
+            automa->stats->closure_duplicates += stats->closure_duplicates;
+            automa->stats->kernel_insertions += stats->kernel_insertions;
+            automa->stats->kernel_duplicates += stats->kernel_duplicates;
+            automa->stats->kernel_comparisons += stats->kernel_comparisons;
+            automa->stats->kernel_lookup_hits += stats->kernel_lookup_hits;
+            automa->stats->kernel_lookup_misses += stats->kernel_lookup_misses;
+        }
+    }
+
+    canonicalizeStateNumbering(automa);
+
+    return automa->states_count;
+}
+
+/**
+* Ritorna i lookahead dell'item di riduzione "item", la riduzione "reduction" (contando gli item completi) dello stato
+*/
+uint64_t* reductionLookahead(struct conflict_analysis* analysis, struct grammar* grammar, int state, int reduction, lr0_item item){
+    if (itemProduction(item) == 0){
+        return analysis->end_of_input;
+    }
+    switch (analysis->kind){
+        case slr_tables: return &analysis->follow[nonTerminalIndex(grammar, grammar->productions[itemProduction(item)].driver) * analysis->words];
+        case lalr_tables: return &analysis->lalr_sets[(size_t)(analysis->first_reduction[state] + reduction) * analysis->words];
+        default: return analysis->all_terminals;
+    }
+}
+
+void recordConflict(struct conflict_analysis* analysis, int state, bool reduceReduce, lr0_item reduce, lr0_item otherReduce, uint64_t* a, uint64_t* b){
+    ensureCapacity(analysis->arena, (void**)&analysis->conflicts, &analysis->conflicts_capacity, analysis->conflicts_count + 1, sizeof(struct conflict));
+    struct conflict* conflict = &analysis->conflicts[analysis->conflicts_count++];
+    conflict->state = state;
+    conflict->reduce_reduce = reduceReduce;
+    conflict->reduce = reduce;
+    conflict->other_reduce = otherReduce;
+    conflict->terminals = arenaAlloc(analysis->arena, analysis->words * sizeof(uint64_t));
+    for (int w=0; w<analysis->words; w++){
+        conflict->terminals[w] = a[w] & b[w];
+    }
+}
+
+/**
+* Controlla i conflitti shift/reduce e reduce/reduce dello stato (gia' espanso) e li registra nell'analisi
+*
+* Ritorna: il numero di conflitti trovati nello stato
+*/
+int checkStateConflicts(struct conflict_analysis* analysis, struct automa* automa, int stateId){
+    struct grammar* grammar = automa->grammar;
+    struct automa_state* state = &automa->states[stateId];
+    int words = analysis->words;
+    int before = analysis->conflicts_count;
+
+    memset(analysis->scratch_shift, 0, words * sizeof(uint64_t));
+    for (int tr=0; tr<state->transition_count; tr++){
+        if (!isNonTerminal(grammar, state->transitions[tr].by)){
+            setBit(analysis->scratch_shift, state->transitions[tr].by);
+        }
+    }
+
+    // reduce/reduce: le coppie di riduzioni vengono confrontate solo se i lookahead di una riduzione
+    // intersecano l'unione di quelli delle precedenti
+    memset(analysis->scratch_reduced, 0, words * sizeof(uint64_t));
+    int reductions = 0;
+    for (int i=0; i<state->items_count; i++){
+        lr0_item item = state->items[i];
+        if (symbolAfterMarker(grammar, item) != NO_SYMBOL){
+            continue;
+        }
+        uint64_t* lookahead = reductionLookahead(analysis, grammar, stateId, reductions, item);
+
+        bool shiftReduce = false, reduceReduce = false;
+        for (int w=0; w<words; w++){
+            shiftReduce |= (lookahead[w] & analysis->scratch_shift[w]) != 0;
+            reduceReduce |= (lookahead[w] & analysis->scratch_reduced[w]) != 0;
+            analysis->scratch_reduced[w] |= lookahead[w];
+        }
+        if (shiftReduce){
+            recordConflict(analysis, stateId, false, item, 0, lookahead, analysis->scratch_shift);
+        }
+        for (int k=0; k<reductions && reduceReduce; k++){
+            bool overlap = false;
+            for (int w=0; w<words && !overlap; w++){
+                overlap = (lookahead[w] & analysis->scratch_lookaheads[k][w]) != 0;
+            }
+            if (overlap){
+                recordConflict(analysis, stateId, true, analysis->scratch_reductions[k], item, analysis->scratch_lookaheads[k], lookahead);
+            }
+        }
+
+        int capacity = analysis->scratch_reductions_capacity;
+        ensureCapacity(analysis->arena, (void**)&analysis->scratch_reductions, &capacity, reductions + 1, sizeof(lr0_item));
+        ensureCapacity(analysis->arena, (void**)&analysis->scratch_lookaheads, &analysis->scratch_reductions_capacity, reductions + 1, sizeof(uint64_t*));
+        analysis->scratch_reductions[reductions] = item;
+        analysis->scratch_lookaheads[reductions++] = lookahead;
+    }
+
+    int found = analysis->conflicts_count - before;
+    if (found > 0){
+        analysis->conflicting_states++;
+        if (analysis->first_conflict_state == -1){
+            analysis->first_conflict_state = stateId;
+        }
+    }
+    return found;
+}
+
+/**
+* Completa lo stato unmarked stateId, che contiene solo il kernel: calcola la closure, aggiunge le transizioni
+* (creando gli stati con un kernel non ancora presente nell'automa) e determina il tipo dello stato
+*/
+void expandState(struct automa* automa, int unmarkedStateId){
+    struct arena* arena = automa->arena;
+    struct grammar* grammar = automa->grammar;
+
+    struct automa_state* state = &automa->states[unmarkedStateId];
+
+    // lo stato unmarked contiene solo il kernel: lo si copia nel buffer di lavoro in cui verra' calcolata la closure
+    ensureCapacity(arena, (void**)&automa->scratch_items, &automa->scratch_items_capacity, state->items_count, sizeof(lr0_item));
+    memcpy(automa->scratch_items, state->items, state->items_count * sizeof(lr0_item));
+    state->items = automa->scratch_items;
+    state->items_capacity = automa->scratch_items_capacity;
+    state->transitions = automa->scratch_transitions;
+    state->transition_capacity = automa->scratch_transitions_capacity;
+
+    // closure del kernel dello stato unmarked
+    double closureStart = automa->stats != NULL ? currentTimeSeconds() : 0;
+    computeClosure(automa, state);
+    if (automa->stats != NULL){
+        automa->stats->closure_seconds += currentTimeSeconds() - closureStart;
+    }
+    groupItemsBySymbol(automa, state);
+
+    for (int i=0; i<automa->states[unmarkedStateId].items_count; i++){ // aggiunta delle transizioni a partire dagli stati unmarked
+
+        lr0_item item = automa->states[unmarkedStateId].items[i];
+        struct production* prod = &grammar->productions[itemProduction(item)];
+
+        int marker_pos = itemMarker(item);
+        if (marker_pos < prod->body_length){ // se il marker non è in ultima posizione (le epsilon produzioni hanno body vuoto)
+            int nextSymbol = prod->body[marker_pos];
+
+            // se esiste gia una transizione tramite nextSymbol il kernel dello stato destinazione e' gia completo:
+            // tutti gli item con nextSymbol dopo il marker sono stati aggiunti alla creazione della transizione
+            if (automa->scratch_symbol_target[nextSymbol] != -1){
+                continue;
+            }
+
+            int kernelEqualTo;
+            double lookupStart = automa->stats != NULL ? currentTimeSeconds() : 0;
+            if (linearKernelLookup){
+                kernelEqualTo = getKernelEqualToLinear(automa, unmarkedStateId, nextSymbol);
+            }else{
+                kernelEqualTo = getKernelEqualTo(automa, nextSymbol);
+            }
+            if (automa->stats != NULL){
+                automa->stats->kernel_lookup_seconds += currentTimeSeconds() - lookupStart;
+                automa->stats->kernel_lookup_hits += kernelEqualTo != -1;
+                automa->stats->kernel_lookup_misses += kernelEqualTo == -1;
+            }
+
+            if (kernelEqualTo != -1){ // kernel gia presente, aggiungi solo la transizione verso lo stato specificato da kernelEqualTo
+
+                addTransition(automa, unmarkedStateId, nextSymbol, kernelEqualTo);
+
+            }else{ // nuovo stato
+
+                int newStateId = addState(automa);
+                addTransition(automa, unmarkedStateId, nextSymbol, newStateId);
+
+                // aggiunta del kernel completo al nuovo stato: tutti gli item con nextSymbol dopo il marker, a partire da quello corrente.
+                // Il kernel viene allocato con la dimensione esatta
+                struct automa_state* newState = &automa->states[newStateId];
+                int kernelSize = automa->scratch_symbol_count[nextSymbol];
+                lr0_item* group = &automa->scratch_grouped_items[automa->scratch_symbol_first[nextSymbol]];
+                newState->items = arenaAlloc(arena, kernelSize * sizeof(lr0_item));
+                newState->items_capacity = kernelSize;
+
+                for (int k=0; k<kernelSize; k++){
+                    bool added = addItemToKernel(arena, newState, group[k]);
+                    if (automa->stats != NULL){
+                        automa->stats->kernel_insertions += added;
+                        automa->stats->kernel_duplicates += !added;
+                    }
+                }
+                addKernelToTable(automa, newStateId);
+
+            }
+
+
+        }else{ // marker in ultima posizione : reducing item (mark dello stato come stato finale oppure accept)
+            if (itemProduction(item) == 0){ // K -> S. dove K e' il fresh symbol
+                automa->states[unmarkedStateId].type = accept;
+            }else{
+                automa->states[unmarkedStateId].type = final;
+            }
+        }
+
+    }
+
+    // lo stato e' completo: gli item e le transizioni vengono spostati dai buffer di lavoro in array di dimensione esatta
+    state = &automa->states[unmarkedStateId];
+    for (int tr=0; tr<state->transition_count; tr++){
+        automa->scratch_symbol_target[state->transitions[tr].by] = -1;
+        automa->scratch_symbol_count[state->transitions[tr].by] = 0;
+    }
+    automa->scratch_items = state->items;
+    automa->scratch_items_capacity = state->items_capacity;
+    automa->scratch_transitions = state->transitions;
+    automa->scratch_transitions_capacity = state->transition_capacity;
+
+    state->items = arenaAlloc(arena, state->items_count * sizeof(lr0_item));
+    memcpy(state->items, automa->scratch_items, state->items_count * sizeof(lr0_item));
+    state->items_capacity = state->items_count;
+    state->transitions = arenaAlloc(arena, state->transition_count * sizeof(struct transition));
+    memcpy(state->transitions, automa->scratch_transitions, state->transition_count * sizeof(struct transition));
+    state->transition_capacity = state->transition_count;
+}
+
+/**
+* Aggiunge all'automa lo stato 0, con il solo kernel K -> .S, e prepara i buffer di lavoro di expandState
+*/
+void initConstruction(struct automa* automa, struct grammar* grammar){
+    struct arena* arena = automa->arena;
+    automa->grammar = grammar;
+
+    // aggiunta all'automa dello stato 0 con il suo kernel
+    int state0 = addState(automa);
+
+    // aggiunta dell'item del fresh symbol (produzione 0) al kernel dello stato iniziale 0
+    automa->states[state0].items = arenaAlloc(arena, sizeof(lr0_item));
+    automa->states[state0].items[0] = makeItem(0, 0, true);
+    automa->states[state0].items_count = 1;
+    automa->states[state0].items_capacity = 1;
+    automa->states[state0].kernel_items_count = 1;
+    addKernelToTable(automa, state0);
+
+    int symbolsCount = grammar->symbols.symbols_count;
+    automa->scratch_symbol_target = arenaAlloc(arena, symbolsCount * sizeof(int));
+    for (int symbol=0; symbol<symbolsCount; symbol++){
+        automa->scratch_symbol_target[symbol] = -1;
+    }
+}
+
+/**
+* Generazione dell'automa caratteristico,
+* Ritorna: il numero di stati dell'automa caratteristico
+*/
+int generateAutomaChar(struct automa* automa, struct grammar* grammar){
+    automa->grammar = grammar;
+
+    if (constructionThreads > 1){
+        return generateAutomaParallel(automa, grammar, constructionThreads);
+    }
+
+    //////////////// INIZIALIZZAZIONE /////////////////
+    initConstruction(automa, grammar);
+    computeClosureSets(automa);
+
+    /////////////// SVOLGIMENTO //////////////////
+    int unmarkedStateId = 0;
+    while ( unmarkedStateId < automa->states_count) {   // finche esiste uno stato unmarked
+        expandState(automa, unmarkedStateId);
+
+        // con LR(0) e SLR i conflitti dello stato sono noti appena e' stato espanso
+        struct conflict_analysis* analysis = automa->conflicts;
+        if (analysis != NULL && analysis->kind != lalr_tables && analysis->checked_states == unmarkedStateId){
+            analysis->checked_states++;
+            if (checkStateConflicts(analysis, automa, unmarkedStateId) > 0 && analysis->fail_fast){
+                analysis->aborted = true;
+                break;
+            }
+        }
+        unmarkedStateId++;
+    }
+
+    return automa->states_count;
+
+}
+
+
+/////////////////////////////// CACHE DELL'AUTOMA //////////////////////////////
+
+static inline uint64_t hashBytes(uint64_t hash, const void* data, size_t length){
+    const unsigned char* bytes = data;
+    for (size_t i=0; i<length; i++){ // FNV-1a a 64 bit
+        hash ^= bytes[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+/**
+* Hash della grammatica normalizzata: nomi dei simboli (nell'ordine degli id), modalita' dei simboli e lista
+* delle produzioni. Due grammatiche con lo stesso hash producono lo stesso automa.
+*/
+uint64_t hashGrammar(struct grammar* grammar){
+    uint64_t hash = 14695981039346656037u;
+    uint32_t header[4] = { CACHE_VERSION, grammar->symbols.multi_character, grammar->symbols.terminals_count, grammar->symbols.symbols_count };
+
+    hash = hashBytes(hash, header, sizeof(header));
+    for (int symbol=0; symbol<grammar->symbols.symbols_count; symbol++){
+        const char* name = symbolName(grammar, symbol);
+        hash = hashBytes(hash, name, strlen(name) + 1);
+    }
+    for (int t=0; t<grammar->productions_count; t++){
+        struct production* production = &grammar->productions[t];
+        hash = hashBytes(hash, &production->driver, sizeof(int));
+        hash = hashBytes(hash, &production->body_length, sizeof(int));
+        hash = hashBytes(hash, production->body, production->body_length * sizeof(int));
+    }
+    return hash;
+}
+
+void cachePath(char* path, size_t size, const char* directory, uint64_t hash){
+    snprintf(path, size, "%s/%016llx.lr0", directory, (unsigned long long)hash);
+}
+
+/**
+* Controlla che un array di "count" elementi da "size" byte che inizia a "offset" sia contenuto nel file
+*/
+bool cacheArrayFits(uint64_t offset, uint64_t count, size_t size, uint64_t fileSize){
+    return offset <= fileSize && count <= (fileSize - offset) / size;
+}
+
+/**
+* Controlla uno stato della cache prima di utilizzarlo: item e transizioni devono seguire quelli dello stato
+* precedente (come li scrive writeAutomaImage) ed essere contenuti nei rispettivi array, ogni item deve riferire una produzione esistente con il marker al piu' alla fine
+* del body e ogni transizione deve partire dallo stato "id" con un simbolo e una destinazione esistenti. Una cache danneggiata viene cosi' scartata
+* invece di essere utilizzata.
+*/
+bool validCacheState(struct grammar* grammar, const struct cache_header* header, uint32_t id, const struct cache_state* cached,
+                     const lr0_item* items, const struct transition* transitions){
+    bool contiguous = id == 0 ? cached->items_first == 0 && cached->transitions_first == 0 :
+        cached->items_first == cached[-1].items_first + cached[-1].items_count &&
+        cached->transitions_first == cached[-1].transitions_first + cached[-1].transition_count;
+    if (!contiguous || cached->items_first > header->items_count || cached->items_count > header->items_count - cached->items_first ||
+        cached->transitions_first > header->transitions_count || cached->transition_count > header->transitions_count - cached->transitions_first ||
+        cached->kernel_items_count > cached->items_count || cached->type > final){
+        return false;
+    }
+
+    for (uint32_t i=0; i<cached->items_count; i++){
+        lr0_item item = items[cached->items_first + i];
+        if (itemProduction(item) >= grammar->productions_count ||
+            itemMarker(item) > grammar->productions[itemProduction(item)].body_length){
+            return false;
+        }
+    }
+    for (uint32_t tr=0; tr<cached->transition_count; tr++){
+        const struct transition* transition = &transitions[cached->transitions_first + tr];
+        if (transition->from != (int)id || transition->by < 0 || transition->by >= grammar->symbols.symbols_count ||
+            transition->destination < 0 || (uint32_t)transition->destination >= header->states_count){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+* Carica l'automa dalla cache "path" tramite mmap. Gli item e le transizioni degli stati puntano alla memoria
+* mappata (in sola lettura), che resta valida fino a releaseAutomaCache.
+*
+* Ritorna: false se il file non esiste, non corrisponde alla grammatica (versione, hash o dimensioni diverse) o e'
+* danneggiato (item o transizioni fuori dai limiti)
+*/
+bool loadAutomaCache(struct automa* automa, struct grammar* grammar, const char* path, uint64_t hash){
+    int fd = open(path, O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(struct cache_header)){
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED){
+        return false;
+    }
+
+    const struct cache_header* header = mapped;
+    const unsigned char* base = mapped;
+    bool valid = memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) == 0 && header->version == CACHE_VERSION &&
+        header->byte_order == CACHE_BYTE_ORDER && header->grammar_hash == hash && header->file_size == (uint64_t)info.st_size &&
+        header->productions_count == (uint32_t)grammar->productions_count && header->symbols_count == (uint32_t)grammar->symbols.symbols_count &&
+        header->states_count > 0 &&
+        header->states_offset % _Alignof(struct cache_state) == 0 && header->items_offset % _Alignof(lr0_item) == 0 &&
+        header->transitions_offset % _Alignof(struct transition) == 0 &&
+        cacheArrayFits(header->states_offset, header->states_count, sizeof(struct cache_state), header->file_size) &&
+        cacheArrayFits(header->items_offset, header->items_count, sizeof(lr0_item), header->file_size) &&
+        cacheArrayFits(header->transitions_offset, header->transitions_count, sizeof(struct transition), header->file_size);
+    if (!valid){
+        munmap(mapped, info.st_size);
+        return false;
+    }
+
+    const struct cache_state* states = (const struct cache_state*)(base + header->states_offset);
+    lr0_item* items = (lr0_item*)(base + header->items_offset);
+    struct transition* transitions = (struct transition*)(base + header->transitions_offset);
+
+    automa->grammar = grammar;
+    automa->states_count = 0;
+    ensureCapacity(automa->arena, (void**)&automa->states, &automa->states_capacity, header->states_count, sizeof(struct automa_state));
+    for (uint32_t id=0; id<header->states_count; id++){
+        const struct cache_state* cached = &states[id];
+        if (!validCacheState(grammar, header, id, cached, items, transitions)){
+            munmap(mapped, info.st_size);
+            return false;
+        }
+
+        struct automa_state state = {
+            .items = items + cached->items_first,
+            .transitions = transitions + cached->transitions_first,
+            .items_count = cached->items_count,
+            .items_capacity = cached->items_count,
+            .kernel_items_count = cached->kernel_items_count,
+            .transition_count = cached->transition_count,
+            .transition_capacity = cached->transition_count,
+            .type = cached->type
+        };
+        automa->states[id] = state;
+    }
+    const struct cache_state* last = &states[header->states_count - 1];
+    if (last->items_first + last->items_count != header->items_count || last->transitions_first + last->transition_count != header->transitions_count){
+        munmap(mapped, info.st_size);
+        return false;
+    }
+    automa->states_count = header->states_count;
+    automa->mapped_cache = mapped;
+    automa->mapped_cache_size = info.st_size;
+    return true;
+}
+
+/**
+* Scrive su "out" l'immagine binaria dell'automa nel formato della cache, associata alla grammatica con hash "hash".
+* Utilizzata sia dalla cache che dal formato di output binario (--format=binary).
+*
+* Ritorna: false se la scrittura non e' riuscita
+*/
+bool writeAutomaImage(FILE* out, struct automa* automa, uint64_t hash){
+    struct cache_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.grammar_hash = hash;
+    header.productions_count = automa->grammar->productions_count;
+    header.symbols_count = automa->grammar->symbols.symbols_count;
+    header.states_count = automa->states_count;
+    for (int id=0; id<automa->states_count; id++){
+        header.items_count += automa->states[id].items_count;
+        header.transitions_count += automa->states[id].transition_count;
+    }
+    header.states_offset = sizeof(struct cache_header);
+    header.items_offset = header.states_offset + header.states_count * sizeof(struct cache_state);
+    header.transitions_offset = header.items_offset + ((header.items_count * sizeof(lr0_item) + 7) & ~(uint64_t)7);
+    header.file_size = header.transitions_offset + header.transitions_count * sizeof(struct transition);
+
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1;
+    uint64_t itemsFirst = 0, transitionsFirst = 0;
+    for (int id=0; id<automa->states_count && written; id++){
+        struct cache_state cached = {
+            .items_first = itemsFirst,
+            .transitions_first = transitionsFirst,
+            .items_count = automa->states[id].items_count,
+            .kernel_items_count = automa->states[id].kernel_items_count,
+            .transition_count = automa->states[id].transition_count,
+            .type = automa->states[id].type
+        };
+        written = fwrite(&cached, sizeof(cached), 1, out) == 1;
+        itemsFirst += cached.items_count;
+        transitionsFirst += cached.transition_count;
+    }
+    for (int id=0; id<automa->states_count && written; id++){
+        written = fwrite(automa->states[id].items, sizeof(lr0_item), automa->states[id].items_count, out) == (size_t)automa->states[id].items_count;
+    }
+    if (written && (header.items_count * sizeof(lr0_item)) % 8 != 0){ // allineamento dell'array delle transizioni
+        uint32_t padding = 0;
+        written = fwrite(&padding, sizeof(padding), 1, out) == 1;
+    }
+    for (int id=0; id<automa->states_count && written; id++){
+        written = fwrite(automa->states[id].transitions, sizeof(struct transition), automa->states[id].transition_count, out) == (size_t)automa->states[id].transition_count;
+    }
+    return written;
+}
+
+/**
+* Scrive l'automa nella cache "path". Il file viene scritto con un nome temporaneo e poi rinominato, quindi un
+* processo concorrente non vede mai una cache incompleta.
+*
+* Ritorna: false se il file non puo' essere scritto
+*/
+bool writeAutomaCache(struct automa* automa, const char* path, uint64_t hash){
+    char temporaryPath[4096];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.%d.tmp", path, (int)getpid());
+    FILE* out = fopen(temporaryPath, "wb");
+    if (out == NULL){
+        return false;
+    }
+
+    bool written = writeAutomaImage(out, automa, hash);
+    written = fclose(out) == 0 && written;
+    if (!written || rename(temporaryPath, path) != 0){
+        remove(temporaryPath);
+        return false;
+    }
+    return true;
+}
+
+/**
+* Costruisce l'automa utilizzando la cache nella cartella "directory": se esiste una cache per la grammatica
+* viene caricata, altrimenti l'automa viene generato con generateAutomaChar e scritto nella cache.
+*/
+int generateAutomaCached(struct automa* automa, struct grammar* grammar, const char* directory){
+    char path[4096];
+    uint64_t hash = hashGrammar(grammar);
+    cachePath(path, sizeof(path), directory, hash);
+
+    if (loadAutomaCache(automa, grammar, path, hash)){
+        if (automa->stats != NULL){
+            automa->stats->cache = "hit";
+        }
+        return automa->states_count;
+    }
+
+    if (automa->stats != NULL){
+        automa->stats->cache = "miss";
+    }
+    int statesCount = generateAutomaChar(automa, grammar);
+    if (!writeAutomaCache(automa, path, hash)){
+        fprintf(stderr, "Impossibile scrivere la cache %s\n", path);
+    }
+    return statesCount;
+}
+
+/**
+* Rilascia la memoria mappata dalla cache (se l'automa e' stato caricato dalla cache)
+*/
+void releaseAutomaCache(struct automa* automa){
+    if (automa->mapped_cache != NULL){
+        munmap(automa->mapped_cache, automa->mapped_cache_size);
+        automa->mapped_cache = NULL;
+        automa->mapped_cache_size = 0;
+    }
+}
+
+/////////////////////////////// AGGIORNAMENTO INCREMENTALE //////////////////////////////
+
+/**
+* Applica alla grammatica (gia' finalizzata) le modifiche lette da source, una per riga: "+ A -> beta" aggiunge le
+* produzioni, "- A -> beta" le rimuove; le righe vuote e quelle che iniziano con '#' vengono ignorate. Le produzioni
+* aggiunte seguono quelle esistenti, quelle rimosse vengono eliminate mantenendo l'ordine delle altre, poi la
+* grammatica viene finalizzata di nuovo. In diff vengono registrate le corrispondenze tra vecchi e nuovi id, le
+* modifiche non applicate vengono segnalate su report.
+*/
+void applyGrammarDiff(struct grammar* grammar, FILE* source, FILE* report, struct grammar_diff* diff){
+    struct arena* arena = grammar->arena;
+    int freshSymbol = grammar->productions[0].driver;
+    char* line = NULL;
+    size_t lineCapacity = 0;
+
+    memset(diff, 0, sizeof(struct grammar_diff));
+    diff->old_productions_count = grammar->productions_count;
+    diff->old_symbols_count = grammar->symbols.symbols_count;
+
+    int removedCapacity = grammar->productions_count;
+    bool* removed = arenaAlloc(arena, removedCapacity * sizeof(bool));
+    memset(removed, 0, removedCapacity * sizeof(bool));
+    int affectedCapacity = 16, affectedCount = 0;
+    int* affected = arenaAlloc(arena, affectedCapacity * sizeof(int)); // driver modificati (id precedenti a finalizeGrammar)
+
+    while (getline(&line, &lineCapacity, source) > 0){
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#'){
+            continue;
+        }
+
+        // le righe scartate e quelle di rimozione non aggiungono simboli: produzioni e simboli letti vengono annullati
+        int before = grammar->productions_count;
+        int symbolsBefore = grammar->symbols.symbols_count;
+        if ((line[0] != '+' && line[0] != '-') || addProduction(grammar, line + 1) == false){
+            fprintf(report, "La modifica %s non e' stata applicata: il formato e' + A -> beta oppure - A -> beta\n", line);
+            grammar->productions_count = before;
+            truncateSymbolTable(&grammar->symbols, symbolsBefore);
+            continue;
+        }
+
+        bool usesFresh = false;
+        for (int t=before; t<grammar->productions_count; t++){
+            usesFresh |= grammar->productions[t].driver == freshSymbol;
+            for (int i=0; i<grammar->productions[t].body_length; i++){
+                usesFresh |= grammar->productions[t].body[i] == freshSymbol;
+            }
+        }
+        if (usesFresh){
+            fprintf(report, "La modifica %s non e' stata applicata: utilizza il fresh symbol %s\n", line, symbolName(grammar, freshSymbol));
+            grammar->productions_count = before;
+            truncateSymbolTable(&grammar->symbols, symbolsBefore);
+            continue;
+        }
+
+        if (line[0] == '+'){
+            int oldCapacity = removedCapacity;
+            ensureCapacity(arena, (void**)&removed, &removedCapacity, grammar->productions_count, sizeof(bool));
+            memset(removed + oldCapacity, 0, (removedCapacity - oldCapacity) * sizeof(bool));
+            for (int t=before; t<grammar->productions_count; t++){
+                ensureCapacity(arena, (void**)&affected, &affectedCapacity, affectedCount + 1, sizeof(int));
+                affected[affectedCount++] = grammar->productions[t].driver;
+                removed[t] = false;
+                diff->added++;
+            }
+            continue;
+        }
+
+        // rimozione: le produzioni appena lette servono solo per il confronto con quelle esistenti
+        for (int t=before; t<grammar->productions_count; t++){
+            struct production* target = &grammar->productions[t];
+            int found = -1;
+            for (int q=1; q<before && found == -1; q++){
+                struct production* candidate = &grammar->productions[q];
+                if (!removed[q] && candidate->driver == target->driver && candidate->body_length == target->body_length &&
+                    memcmp(candidate->body, target->body, target->body_length * sizeof(int)) == 0){
+                    found = q;
+                }
+            }
+
+            if (found == -1){
+                fprintf(report, "La produzione da rimuovere %s -> ", symbolName(grammar, target->driver));
+                printBody(report, grammar, target, -1);
+                fprintf(report, " non esiste\n");
+            }else{
+                removed[found] = true;
+                ensureCapacity(arena, (void**)&affected, &affectedCapacity, affectedCount + 1, sizeof(int));
+                affected[affectedCount++] = target->driver;
+                diff->removed++;
+            }
+        }
+        grammar->productions_count = before;
+        truncateSymbolTable(&grammar->symbols, symbolsBefore);
+    }
+    free(line);
+
+    // eliminazione delle produzioni rimosse mantenendo l'ordine delle altre
+    diff->production_map = arenaAlloc(arena, diff->old_productions_count * sizeof(int));
+    int kept = 0;
+    for (int t=0; t<grammar->productions_count; t++){
+        int newId = removed[t] ? -1 : kept;
+        if (t < diff->old_productions_count){
+            diff->production_map[t] = newId;
+        }
+        if (!removed[t]){
+            grammar->productions[kept] = grammar->productions[t];
+            grammar->productions[kept].production_id = kept;
+            kept++;
+        }
+    }
+    grammar->productions_count = kept;
+
+    // i simboli aggiunti (id successivi a quelli esistenti) e i driver rimasti senza produzioni cambiano classe:
+    // gli id vengono ricalcolati e le corrispondenze composte
+    int* newId = finalizeGrammar(grammar);
+    diff->symbol_map = arenaAlloc(arena, diff->old_symbols_count * sizeof(int));
+    memcpy(diff->symbol_map, newId, diff->old_symbols_count * sizeof(int));
+
+    diff->affected_drivers = arenaAlloc(arena, grammar->symbols.symbols_count * sizeof(bool));
+    memset(diff->affected_drivers, 0, grammar->symbols.symbols_count * sizeof(bool));
+    for (int i=0; i<affectedCount; i++){
+        diff->affected_drivers[newId[affected[i]]] = true;
+    }
+}
+
+/**
+* Aggiorna l'automa dopo applyGrammarDiff senza ricostruirlo da zero. Item e transizioni vengono tradotti nei nuovi
+* id; vengono ricostruiti solo gli stati che contenevano un item di una produzione rimossa oppure con un item del
+* kernel che ha dopo il marker un non terminale dalla cui closure si raggiunge un driver modificato, e gli stati
+* nuovi raggiungibili da questi. Gli altri stati mantengono item e transizioni; alla fine gli stati non piu'
+* raggiungibili vengono eliminati. Ogni stato rimasto mantiene il suo numero: i numeri degli stati eliminati vengono
+* riassegnati, in ordine di numero, agli stati rimasti oltre la nuova fine dell'automa (per lo piu' quelli creati
+* dall'aggiornamento), quindi uno stato esistente cambia numero solo se l'automa aggiornato ha meno stati del suo numero.
+*/
+void updateAutomaIncremental(struct automa* automa, struct grammar_diff* diff, struct incremental_report* report){
+    struct arena* arena = automa->arena;
+    struct grammar* grammar = automa->grammar;
+    int oldStatesCount = automa->states_count;
+    bool* rebuild = arenaAlloc(arena, oldStatesCount * sizeof(bool));
+
+    memset(report, 0, sizeof(struct incremental_report));
+
+    // traduzione degli item e delle transizioni nei nuovi id (in array nuovi: l'automa puo' provenire dalla cache)
+    for (int id=0; id<oldStatesCount; id++){
+        struct automa_state* state = &automa->states[id];
+        lr0_item* items = arenaAlloc(arena, state->items_count * sizeof(lr0_item));
+        int itemsCount = 0, kernelCount = 0;
+
+        rebuild[id] = false;
+        for (int i=0; i<state->items_count; i++){
+            int production = diff->production_map[itemProduction(state->items[i])];
+            if (production == -1){
+                rebuild[id] = true;
+                continue;
+            }
+            items[itemsCount++] = makeItem(production, itemMarker(state->items[i]), itemIsKernel(state->items[i]));
+            kernelCount += itemIsKernel(state->items[i]);
+        }
+
+        struct transition* transitions = arenaAlloc(arena, state->transition_count * sizeof(struct transition));
+        for (int tr=0; tr<state->transition_count; tr++){
+            transitions[tr] = state->transitions[tr];
+            transitions[tr].by = diff->symbol_map[transitions[tr].by];
+        }
+
+        state->items = items;
+        state->items_count = itemsCount;
+        state->items_capacity = itemsCount;
+        state->kernel_items_count = kernelCount;
+        state->transitions = transitions;
+        state->transition_capacity = state->transition_count;
+    }
+
+    // closure per la nuova grammatica e non terminali la cui closure raggiunge un driver modificato
+    computeClosureSets(automa);
+    int symbolsCount = grammar->symbols.symbols_count;
+    automa->scratch_symbol_target = arenaAlloc(arena, symbolsCount * sizeof(int));
+    for (int symbol=0; symbol<symbolsCount; symbol++){
+        automa->scratch_symbol_target[symbol] = -1;
+    }
+
+    int words = automa->closure_set_words;
+    int nonTerminals = nonTerminalsCount(grammar);
+    uint64_t* affectedProductions = arenaAlloc(arena, words * sizeof(uint64_t));
+    bool* reachesAffected = arenaAlloc(arena, nonTerminals * sizeof(bool));
+    memset(affectedProductions, 0, words * sizeof(uint64_t));
+    for (int t=0; t<grammar->productions_count; t++){
+        if (diff->affected_drivers[grammar->productions[t].driver]){
+            affectedProductions[t / 64] |= (uint64_t)1 << (t % 64);
+        }
+    }
+    for (int n=0; n<nonTerminals; n++){
+        reachesAffected[n] = diff->affected_drivers[grammar->symbols.terminals_count + n];
+        for (int w=0; w<words && !reachesAffected[n]; w++){
+            reachesAffected[n] = (automa->closure_sets[n * words + w] & affectedProductions[w]) != 0;
+        }
+    }
+
+    int maxKernel = 1;
+    for (int id=0; id<oldStatesCount; id++){
+        struct automa_state* state = &automa->states[id];
+        for (int i=0; i<state->kernel_items_count && !rebuild[id]; i++){
+            int symbol = symbolAfterMarker(grammar, state->items[i]);
+            rebuild[id] = symbol != NO_SYMBOL && isNonTerminal(grammar, symbol) && reachesAffected[nonTerminalIndex(grammar, symbol)];
+        }
+        if (state->kernel_items_count > maxKernel){
+            maxKernel = state->kernel_items_count;
+        }
+    }
+
+    // tabella dei kernel con i nuovi id: un kernel diventato uguale a quello di uno stato precedente resta fuori
+    // dalla tabella e le transizioni verso lo stato vengono deviate sul precedente, cosi' non sara' piu' raggiungibile
+    ensureKernelScratch(automa, maxKernel);
+    initKernelTable(arena, &automa->kernels, KERNEL_TABLE_INITIAL_SIZE);
+    int* equivalent = arenaAlloc(arena, oldStatesCount * sizeof(int));
+    for (int id=0; id<oldStatesCount; id++){
+        int kernelSize = canonicalKernelOfState(&automa->states[id], automa->scratch_kernel);
+        equivalent[id] = id;
+        if (kernelSize > 0){
+            int existing = findKernel(automa, automa->scratch_kernel, kernelSize, hashKernel(automa->scratch_kernel, kernelSize));
+            if (existing == -1){
+                addKernelToTable(automa, id);
+            }else{
+                equivalent[id] = existing;
+            }
+        }
+    }
+    for (int id=0; id<oldStatesCount; id++){
+        struct automa_state* state = &automa->states[id];
+        for (int tr=0; tr<state->transition_count; tr++){
+            state->transitions[tr].destination = equivalent[state->transitions[tr].destination];
+        }
+    }
+
+    // ricostruzione degli stati coinvolti e di quelli nuovi
+    for (int id=0; id<oldStatesCount; id++){
+        struct automa_state* state = &automa->states[id];
+        if (!rebuild[id] || state->kernel_items_count == 0 || equivalent[id] != id){
+            continue;
+        }
+        state->items_count = state->kernel_items_count; // il kernel precede la closure
+        state->transition_count = 0;
+        state->type = normal;
+        expandState(automa, id);
+        report->rebuilt_states++;
+    }
+    for (int id=oldStatesCount; id<automa->states_count; id++){
+        expandState(automa, id);
+        report->new_states++;
+    }
+
+    // eliminazione degli stati non piu' raggiungibili dallo stato 0
+    int statesCount = automa->states_count;
+    int* newId = arenaAlloc(arena, statesCount * sizeof(int));
+    int* queue = arenaAlloc(arena, statesCount * sizeof(int));
+    for (int id=0; id<statesCount; id++){
+        newId[id] = -1;
+    }
+    int queueTail = 0;
+    newId[0] = 0;
+    queue[queueTail++] = 0;
+    for (int head=0; head<queueTail; head++){
+        struct automa_state* state = &automa->states[queue[head]];
+        for (int tr=0; tr<state->transition_count; tr++){
+            if (newId[state->transitions[tr].destination] == -1){
+                newId[state->transitions[tr].destination] = 0;
+                queue[queueTail++] = state->transitions[tr].destination;
+            }
+        }
+    }
+
+    int kept = 0;
+    for (int id=0; id<statesCount; id++){
+        if (newId[id] != -1){
+            newId[id] = id;
+            kept++;
+        }
+    }
+    report->removed_states = statesCount - kept;
+    if (report->removed_states == 0){
+        return;
+    }
+
+    // gli stati rimasti con numero >= kept (gli ultimi, quindi per lo piu' quelli nuovi) occupano, in ordine,
+    // i numeri degli stati eliminati minori di kept; tutti gli altri stati mantengono il loro numero
+    int hole = 0;
+    for (int id=kept; id<statesCount; id++){
+        if (newId[id] == -1){
+            continue;
+        }
+        while (newId[hole] != -1){
+            hole++;
+        }
+        newId[id] = hole;
+        automa->states[hole++] = automa->states[id];
+        report->renumbered_states += id < oldStatesCount;
+    }
+    for (int id=0; id<kept; id++){
+        for (int tr=0; tr<automa->states[id].transition_count; tr++){
+            automa->states[id].transitions[tr].from = id;
+            automa->states[id].transitions[tr].destination = newId[automa->states[id].transitions[tr].destination];
+        }
+    }
+    automa->states_count = kept;
+
+    // tabella dei kernel con i numeri definitivi, riutilizzando le forme canoniche gia' calcolate
+    struct kernel_table oldTable = automa->kernels;
+    initKernelTable(arena, &automa->kernels, oldTable.size);
+    for (int i=0; i<oldTable.size; i++){
+        int id = oldTable.state_ids[i];
+        if (id != -1 && newId[id] != -1){
+            insertIntoKernelTable(&automa->kernels, newId[id], oldTable.hashes[i], oldTable.kernels[i]);
+        }
+    }
+}
+
+/**
+* Aggiunge alla grammatica le produzioni della riga line, lunga length caratteri. Le righe vuote e quelle che
+* iniziano con '#' (commenti) vengono ignorate. Se reportErrors e' true segnala le righe che non rispettano il
+* formato A -> beta.
+*/
+void readGrammarLine(struct grammar* grammar, const char* line, size_t length, bool reportErrors){
+    while (length > 0 && isBlank(line[length - 1]))
+        length--;
+    const char* first = line;
+    while (first < line + length && isBlank(*first))
+        first++;
+    if (first == line + length || *first == '#'){
+        return;
+    }
+
+    if (addProductionText(grammar, line, length) == false && reportErrors){
+        printf("La produzione %.*s non e' stata inserita in quanto non rispetta lo standard: A -> beta\n", (int)length, line);
+    }
+}
+
+/**
+* Legge le produzioni da source, una per riga, in un'unica passata e senza limiti sulla lunghezza delle righe.
+* Un file regolare viene mappato in memoria e letto fino alla fine (le righe vuote vengono ignorate); lo standard
+* input e i file non mappabili vengono invece letti riga per riga e, per lo standard input, la lettura termina alla
+* prima riga vuota, lasciando in source quanto segue (ad esempio l'input di --parse -).
+* Se reportErrors e' true segnala le produzioni che non rispettano il formato A -> beta.
+*/
+void readGrammar(struct grammar* grammar, FILE* source, bool reportErrors){
+    struct stat info;
+    if (source != stdin && fstat(fileno(source), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+        char* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(source), 0);
+        if (data != MAP_FAILED){
+            const char* end = data + info.st_size;
+            for (const char* line = data; line < end; ){
+                const char* newline = memchr(line, '\n', end - line);
+                const char* lineEnd = newline != NULL ? newline : end;
+                readGrammarLine(grammar, line, lineEnd - line, reportErrors);
+                line = lineEnd + 1;
+            }
+            munmap(data, info.st_size);
+            return;
+        }
+    }
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, source)) > 0){
+        if (source == stdin && (line[0] == '\n' || (line[0] == '\r' && line[1] == '\n'))){
+            break;
+        }
+        readGrammarLine(grammar, line, length, reportErrors);
+    }
+    free(line);
+}
+
+/////////////////////////////// NULLABLE, FIRST E FOLLOW //////////////////////////////
+
+/**
+* Costruisce la relazione compatta a partire dalle coppie (from[e], to[e])
+*/
+void buildRelation(struct relation* relation, struct arena* arena, int nodes, int* from, int* to, int edges){
+    relation->nodes_count = nodes;
+    relation->edges_count = edges;
+    relation->first = arenaAlloc(arena, (nodes + 1) * sizeof(int));
+    relation->targets = arenaAlloc(arena, (edges > 0 ? edges : 1) * sizeof(int));
+    memset(relation->first, 0, (nodes + 1) * sizeof(int));
+
+    for (int e=0; e<edges; e++){
+        relation->first[from[e] + 1]++;
+    }
+    for (int x=0; x<nodes; x++){
+        relation->first[x + 1] += relation->first[x];
+    }
+
+    int* next = arenaAlloc(arena, (nodes > 0 ? nodes : 1) * sizeof(int));
+    memcpy(next, relation->first, nodes * sizeof(int));
+    for (int e=0; e<edges; e++){
+        relation->targets[next[from[e]]++] = to[e];
+    }
+}
+
+/**
+* Aggiunge la coppia (x, y) alle coppie from/to (capacity e' la capacita' comune dei due array)
+*/
+static inline void appendEdge(struct arena* arena, int** from, int** to, int* count, int* capacity, int x, int y){
+    if (*count >= *capacity){
+        int oldCapacity = *capacity;
+        ensureCapacity(arena, (void**)from, &oldCapacity, *count + 1, sizeof(int));
+        ensureCapacity(arena, (void**)to, capacity, *count + 1, sizeof(int));
+    }
+    (*from)[*count] = x;
+    (*to)[(*count)++] = y;
+}
+
+/**
+* Propaga i bitset lungo la relazione "dependents" (x -> y se l'insieme di y contiene quello di x) con una coda
+* di lavoro: un nodo viene rielaborato solo quando il suo insieme e' cambiato
+*/
+void propagateWorklist(struct relation* dependents, uint64_t* sets, int words, struct arena* arena){
+    int nodes = dependents->nodes_count;
+    int* queue = arenaAlloc(arena, (nodes > 0 ? nodes : 1) * sizeof(int));  // coda circolare: ogni nodo vi compare al piu' una volta
+    bool* queued = arenaAlloc(arena, (nodes > 0 ? nodes : 1) * sizeof(bool));
+    int head = 0, size = 0;
+
+    for (int x=0; x<nodes; x++){
+        queued[x] = false;
+        for (int w=0; w<words && !queued[x]; w++){
+            queued[x] = sets[x * words + w] != 0;
+        }
+        if (queued[x]){
+            queue[size++] = x;
+        }
+    }
+
+    while (size > 0){
+        int x = queue[head];
+        head = (head + 1) % nodes;
+        size--;
+        queued[x] = false;
+
+        for (int e=dependents->first[x]; e<dependents->first[x + 1]; e++){
+            int y = dependents->targets[e];
+            bool changed = false;
+            for (int w=0; w<words; w++){
+                uint64_t merged = sets[y * words + w] | sets[x * words + w];
+                changed |= merged != sets[y * words + w];
+                sets[y * words + w] = merged;
+            }
+            if (changed && !queued[y]){
+                queued[y] = true;
+                queue[(head + size++) % nodes] = y;
+            }
+        }
+    }
+}
+
+/**
+* Calcola i non terminali annullabili. Ogni produzione conta i simboli del body non ancora annullabili: quando
+* un non terminale diventa annullabile si decrementano solo le produzioni in cui compare, e quelle arrivate a
+* zero rendono annullabile il loro driver. Ogni occorrenza viene esaminata una sola volta.
+*/
+void computeNullableSet(struct grammar* grammar, struct grammar_sets* sets, struct arena* arena){
+    int nonTerminals = nonTerminalsCount(grammar);
+    int productions = grammar->productions_count;
+    sets->nullable = arenaAlloc(arena, (nonTerminals > 0 ? nonTerminals : 1) * sizeof(bool));
+    memset(sets->nullable, 0, nonTerminals * sizeof(bool));
+
+    int* remaining = arenaAlloc(arena, (productions > 0 ? productions : 1) * sizeof(int));
+    int* worklist = arenaAlloc(arena, (nonTerminals > 0 ? nonTerminals : 1) * sizeof(int));
+    int worklistSize = 0;
+    int capacity = productions + 16, edges = 0;
+    int* from = arenaAlloc(arena, capacity * sizeof(int));
+    int* to = arenaAlloc(arena, capacity * sizeof(int));
+
+    // occorrenze dei non terminali nei body; i body con un terminale non saranno mai annullabili
+    for (int t=0; t<productions; t++){
+        struct production* production = &grammar->productions[t];
+        remaining[t] = production->body_length;
+        bool hasTerminal = false;
+        for (int i=0; i<production->body_length && !hasTerminal; i++){
+            hasTerminal = !isNonTerminal(grammar, production->body[i]);
+        }
+        if (hasTerminal){
+            continue;
+        }
+        for (int i=0; i<production->body_length; i++){
+            appendEdge(arena, &from, &to, &edges, &capacity, nonTerminalIndex(grammar, production->body[i]), t);
+        }
+
+        int driver = nonTerminalIndex(grammar, production->driver);
+        if (remaining[t] == 0 && !sets->nullable[driver]){
+            sets->nullable[driver] = true;
+            worklist[worklistSize++] = driver;
+        }
+    }
+
+    struct relation occurrences;
+    buildRelation(&occurrences, arena, nonTerminals, from, to, edges);
+    while (worklistSize > 0){
+        int n = worklist[--worklistSize];
+        for (int e=occurrences.first[n]; e<occurrences.first[n + 1]; e++){
+            int t = occurrences.targets[e];
+            int driver = nonTerminalIndex(grammar, grammar->productions[t].driver);
+            if (--remaining[t] == 0 && !sets->nullable[driver]){
+                sets->nullable[driver] = true;
+                worklist[worklistSize++] = driver;
+            }
+        }
+    }
+}
+
+/**
+* Calcola FIRST di ogni non terminale (richiede nullable). I terminali che iniziano un body, dopo un prefisso
+* annullabile, vengono inseriti subito; per i non terminali in quelle posizioni si registra la dipendenza
+* FIRST(B) -> FIRST(A), poi propagata con propagateWorklist.
+*/
+void computeFirstSets(struct grammar* grammar, struct grammar_sets* sets, struct arena* arena){
+    int nonTerminals = nonTerminalsCount(grammar);
+    int words = sets->words;
+    sets->first = arenaAlloc(arena, ((size_t)nonTerminals * words + 1) * sizeof(uint64_t));
+    memset(sets->first, 0, (size_t)nonTerminals * words * sizeof(uint64_t));
+
+    int capacity = grammar->productions_count + 16, edges = 0;
+    int* from = arenaAlloc(arena, capacity * sizeof(int));
+    int* to = arenaAlloc(arena, capacity * sizeof(int));
+
+    for (int t=0; t<grammar->productions_count; t++){
+        struct production* production = &grammar->productions[t];
+        int driver = nonTerminalIndex(grammar, production->driver);
+
+        for (int i=0; i<production->body_length; i++){
+            int symbol = production->body[i];
+            if (!isNonTerminal(grammar, symbol)){
+                setBit(&sets->first[driver * words], symbol);
+                break;
+            }
+            int n = nonTerminalIndex(grammar, symbol);
+            if (n != driver){
+                appendEdge(arena, &from, &to, &edges, &capacity, n, driver);
+            }
+            if (!sets->nullable[n]){
+                break;
+            }
+        }
+    }
+
+    struct relation dependents;
+    buildRelation(&dependents, arena, nonTerminals, from, to, edges);
+    propagateWorklist(&dependents, sets->first, words, arena);
+}
+
+/**
+* Calcola FOLLOW di ogni non terminale (richiede nullable e FIRST). FOLLOW del fresh symbol contiene il solo
+* terminale di fine input. Per ogni occorrenza di B in A -> alpha B beta si inserisce subito FIRST(beta) in
+* FOLLOW(B) e, se beta e' annullabile, si registra la dipendenza FOLLOW(A) -> FOLLOW(B).
+*/
+void computeFollowSets(struct grammar* grammar, struct grammar_sets* sets, struct arena* arena){
+    int nonTerminals = nonTerminalsCount(grammar);
+    int words = sets->words;
+    sets->follow = arenaAlloc(arena, ((size_t)nonTerminals * words + 1) * sizeof(uint64_t));
+    memset(sets->follow, 0, (size_t)nonTerminals * words * sizeof(uint64_t));
+    setBit(&sets->follow[nonTerminalIndex(grammar, grammar->productions[0].driver) * words], grammar->end_of_input);
+
+    int capacity = grammar->productions_count + 16, edges = 0;
+    int* from = arenaAlloc(arena, capacity * sizeof(int));
+    int* to = arenaAlloc(arena, capacity * sizeof(int));
+    uint64_t* trailer = arenaAlloc(arena, words * sizeof(uint64_t)); // FIRST del suffisso che segue la posizione corrente
+
+    for (int t=0; t<grammar->productions_count; t++){
+        struct production* production = &grammar->productions[t];
+        int driver = nonTerminalIndex(grammar, production->driver);
+        bool suffixNullable = true;
+        memset(trailer, 0, words * sizeof(uint64_t));
+
+        for (int i=production->body_length - 1; i>=0; i--){
+            int symbol = production->body[i];
+            if (!isNonTerminal(grammar, symbol)){
+                memset(trailer, 0, words * sizeof(uint64_t));
+                setBit(trailer, symbol);
+                suffixNullable = false;
+                continue;
+            }
+
+            int n = nonTerminalIndex(grammar, symbol);
+            unionBitset(&sets->follow[n * words], trailer, words);
+            if (suffixNullable && n != driver){
+                appendEdge(arena, &from, &to, &edges, &capacity, driver, n);
+            }
+            if (sets->nullable[n]){
+                unionBitset(trailer, &sets->first[n * words], words);
+            }else{
+                memcpy(trailer, &sets->first[n * words], words * sizeof(uint64_t));
+                suffixNullable = false;
+            }
+        }
+    }
+
+    struct relation dependents;
+    buildRelation(&dependents, arena, nonTerminals, from, to, edges);
+    propagateWorklist(&dependents, sets->follow, words, arena);
+}
+
+/**
+* Calcola nullable, FIRST e FOLLOW della grammatica finalizzata
+*/
+void computeGrammarSets(struct grammar* grammar, struct grammar_sets* sets, struct arena* arena){
+    sets->words = (grammar->symbols.terminals_count + 63) / 64;
+    computeNullableSet(grammar, sets, arena);
+    computeFirstSets(grammar, sets, arena);
+    computeFollowSets(grammar, sets, arena);
+}
+
+/**
+* Calcolo di riferimento per il benchmark: punto fisso che ripercorre tutte le produzioni finche' nullable, FIRST
+* o FOLLOW di qualche non terminale cambia
+*/
+void computeGrammarSetsNaive(struct grammar* grammar, struct grammar_sets* sets, struct arena* arena){
+    int nonTerminals = nonTerminalsCount(grammar);
+    int words = (grammar->symbols.terminals_count + 63) / 64;
+    sets->words = words;
+    sets->nullable = arenaAlloc(arena, (nonTerminals > 0 ? nonTerminals : 1) * sizeof(bool));
+    sets->first = arenaAlloc(arena, ((size_t)nonTerminals * words + 1) * sizeof(uint64_t));
+    sets->follow = arenaAlloc(arena, ((size_t)nonTerminals * words + 1) * sizeof(uint64_t));
+    bool* nullable = sets->nullable;
+    uint64_t* first = sets->first;
+    uint64_t* follow = sets->follow;
+    memset(nullable, 0, nonTerminals * sizeof(bool));
+    memset(first, 0, (size_t)nonTerminals * words * sizeof(uint64_t));
+    memset(follow, 0, (size_t)nonTerminals * words * sizeof(uint64_t));
+
+    int fresh = nonTerminalIndex(grammar, grammar->productions[0].driver);
+    setBit(&follow[fresh * words], grammar->end_of_input);
+    uint64_t* trailer = arenaAlloc(arena, words * sizeof(uint64_t));
+
+    bool changed = true;
+    while (changed){
+        changed = false;
+
+        for (int t=0; t<grammar->productions_count; t++){
+            struct production* production = &grammar->productions[t];
+            int driver = nonTerminalIndex(grammar, production->driver);
+
+            // FIRST e nullable del driver
+            bool prefixNullable = true;
+            for (int i=0; i<production->body_length && prefixNullable; i++){
+                int symbol = production->body[i];
+                if (isNonTerminal(grammar, symbol)){
+                    int n = nonTerminalIndex(grammar, symbol);
+                    for (int w=0; w<words; w++){
+                        uint64_t merged = first[driver * words + w] | first[n * words + w];
+                        changed |= merged != first[driver * words + w];
+                        first[driver * words + w] = merged;
+                    }
+                    prefixNullable = nullable[n];
+                }else{
+                    changed |= !testBit(&first[driver * words], symbol);
+                    setBit(&first[driver * words], symbol);
+                    prefixNullable = false;
+                }
+            }
+            if (prefixNullable && !nullable[driver]){
+                nullable[driver] = true;
+                changed = true;
+            }
+
+            // FOLLOW dei non terminali del body, scorrendo il body da destra verso sinistra
+            memcpy(trailer, &follow[driver * words], words * sizeof(uint64_t));
+            for (int i=production->body_length - 1; i>=0; i--){
+                int symbol = production->body[i];
+                if (isNonTerminal(grammar, symbol)){
+                    int n = nonTerminalIndex(grammar, symbol);
+                    for (int w=0; w<words; w++){
+                        uint64_t merged = follow[n * words + w] | trailer[w];
+                        changed |= merged != follow[n * words + w];
+                        follow[n * words + w] = merged;
+                    }
+                    if (nullable[n]){
+                        unionBitset(trailer, &first[n * words], words);
+                    }else{
+                        memcpy(trailer, &first[n * words], words * sizeof(uint64_t));
+                    }
+                }else{
+                    memset(trailer, 0, words * sizeof(uint64_t));
+                    setBit(trailer, symbol);
+                }
+            }
+        }
+    }
+}
+
+/**
+* Stampa nullable, FIRST e FOLLOW di ogni non terminale
+*/
+void printGrammarSets(FILE* out, struct grammar_sets* sets, struct grammar* grammar){
+    int terminals = grammar->symbols.terminals_count;
+    fprintf(out, "========== NULLABLE, FIRST, FOLLOW ==========\n");
+    for (int n=0; n<nonTerminalsCount(grammar); n++){
+        fprintf(out, "%s%s\tFIRST = {", symbolName(grammar, terminals + n), sets->nullable[n] ? " (nullable)" : "");
+        bool separator = false;
+        for (int t=0; t<terminals; t++){
+            if (testBit(&sets->first[n * sets->words], t)){
+                fprintf(out, "%s %s", separator ? "," : "", symbolName(grammar, t));
+                separator = true;
+            }
+        }
+        fprintf(out, " }\tFOLLOW = {");
+        separator = false;
+        for (int t=0; t<terminals; t++){
+            if (testBit(&sets->follow[n * sets->words], t)){
+                fprintf(out, "%s %s", separator ? "," : "", symbolName(grammar, t));
+                separator = true;
+            }
+        }
+        fprintf(out, " }\n");
+    }
+}
+
+/////////////////////////////// TABELLE DI PARSING //////////////////////////////
+
+static inline int makeAction(int type, int argument){
+    return (argument << 2) | type;
+}
+
+static inline int actionType(int action){
+    return action & 3;
+}
+
+static inline int actionArgument(int action){
+    return action >> 2;
+}
+
+const char* tableKindName(table_kind kind){
+    switch (kind){
+        case slr_tables: return "SLR";
+        case lalr_tables: return "LALR(1)";
+        default: return "LR(0)";
+    }
+}
+
+/**
+* Ritorna la posizione nelle transizioni dello stato della transizione con il simbolo "symbol", -1 se non esiste
+*/
+static inline int findTransition(struct automa_state* state, int symbol){
+    for (int tr=0; tr<state->transition_count; tr++){
+        if (state->transitions[tr].by == symbol){
+            return tr;
+        }
+    }
+    return -1;
+}
+
+/**
+* Algoritmo digraph di DeRemer e Pennello: al termine sets[x] contiene l'unione dei valori iniziali di tutti i nodi
+* raggiungibili da x nella relazione. Le componenti fortemente connesse vengono riconosciute durante la visita
+* (come nell'algoritmo di Tarjan) e tutti i loro nodi ricevono lo stesso insieme, quindi ogni arco viene
+* percorso una sola volta. La visita e' iterativa per non dipendere dalla profondita' dello stack di sistema.
+*/
+void digraph(struct relation* relation, uint64_t* sets, int words, struct arena* arena){
+    int nodes = relation->nodes_count;
+    if (nodes == 0){
+        return;
+    }
+
+    int* depth = arenaAlloc(arena, nodes * sizeof(int));   // 0: non visitato, INT32_MAX: componente conclusa
+    int* stack = arenaAlloc(arena, nodes * sizeof(int));
+    int* callNode = arenaAlloc(arena, nodes * sizeof(int));
+    int* callEdge = arenaAlloc(arena, nodes * sizeof(int));
+    int* callDepth = arenaAlloc(arena, nodes * sizeof(int));
+    memset(depth, 0, nodes * sizeof(int));
+    int stackSize = 0;
+
+    for (int root=0; root<nodes; root++){
+        if (depth[root] != 0){
+            continue;
+        }
+
+        int calls = 0;
+        stack[stackSize++] = root;
+        depth[root] = stackSize;
+        callNode[calls] = root;
+        callEdge[calls] = relation->first[root];
+        callDepth[calls++] = stackSize;
+
+        while (calls > 0){
+            int x = callNode[calls - 1];
+
+            if (callEdge[calls - 1] < relation->first[x + 1]){
+                int y = relation->targets[callEdge[calls - 1]];
+                if (depth[y] == 0){
+                    stack[stackSize++] = y;
+                    depth[y] = stackSize;
+                    callNode[calls] = y;
+                    callEdge[calls] = relation->first[y];
+                    callDepth[calls++] = stackSize;
+                    continue;
+                }
+                if (depth[y] < depth[x]){
+                    depth[x] = depth[y];
+                }
+                unionBitset(&sets[x * words], &sets[y * words], words);
+                callEdge[calls - 1]++;
+                continue;
+            }
+
+            // tutti i successori di x sono stati visitati: se x e' la radice della sua componente la si chiude
+            if (depth[x] == callDepth[calls - 1]){
+                int z;
+                do {
+                    z = stack[--stackSize];
+                    depth[z] = INT32_MAX;
+                    if (z != x){
+                        memcpy(&sets[z * words], &sets[x * words], words * sizeof(uint64_t));
+                    }
+                } while (z != x);
+            }
+
+            calls--;
+            if (calls > 0){
+                int parent = callNode[calls - 1];
+                if (depth[x] < depth[parent]){
+                    depth[parent] = depth[x];
+                }
+                unionBitset(&sets[parent * words], &sets[x * words], words);
+                callEdge[calls - 1]++;
+            }
+        }
+    }
+}
+
+/**
+* Propagazione ingenua, utilizzata come confronto per digraph: percorre tutti gli archi della relazione finche'
+* qualche insieme cambia
+*/
+void propagateNaive(struct relation* relation, uint64_t* sets, int words){
+    bool changed = true;
+    while (changed){
+        changed = false;
+        for (int x=0; x<relation->nodes_count; x++){
+            for (int e=relation->first[x]; e<relation->first[x + 1]; e++){
+                uint64_t* to = &sets[x * words];
+                uint64_t* from = &sets[relation->targets[e] * words];
+                for (int w=0; w<words; w++){
+                    if ((from[w] & ~to[w]) != 0){
+                        to[w] |= from[w];
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+* Calcola i lookahead LALR(1) delle riduzioni sugli stati dell'automa LR(0) con il metodo di DeRemer e Pennello.
+* I nodi sono le transizioni (p, A) con A non terminale:
+*  - DR(p, A): terminali con una transizione uscente da goto(p, A) (piu' il terminale di fine input per la
+*    transizione dello stato iniziale sullo start symbol)
+*  - (p, A) reads (r, C) se r = goto(p, A) e C e' annullabile; Read = DR propagato lungo reads
+*  - (p, A) includes (p', B) se B -> beta A gamma, gamma annullabile e p' --beta--> p; Follow = Read propagato
+*    lungo includes
+*  - la riduzione di A -> w nello stato q (lookback) ha come lookahead l'unione dei Follow(p, A) con p --w--> q
+* Con naivePropagation le relazioni vengono chiuse con propagateNaive invece che con digraph.
+*/
+void computeLalrLookaheads(struct lalr_lookaheads* lookaheads, struct automa* automa, bool naivePropagation, struct arena* arena){
+    struct grammar* grammar = automa->grammar;
+    int states = automa->states_count;
+    int words = (grammar->symbols.terminals_count + 63) / 64;
+    struct grammar_sets grammarSets;
+    grammarSets.words = words;
+    computeNullableSet(grammar, &grammarSets, arena);
+    bool* nullable = grammarSets.nullable;
+
+    // riduzioni di ogni stato
+    lookaheads->words = words;
+    lookaheads->first_reduction = arenaAlloc(arena, (states + 1) * sizeof(int));
+    lookaheads->first_reduction[0] = 0;
+    for (int state=0; state<states; state++){
+        int reductions = 0;
+        for (int i=0; i<automa->states[state].items_count; i++){
+            lr0_item item = automa->states[state].items[i];
+            reductions += itemMarker(item) == grammar->productions[itemProduction(item)].body_length;
+        }
+        lookaheads->first_reduction[state + 1] = lookaheads->first_reduction[state] + reductions;
+    }
+    lookaheads->reductions_count = lookaheads->first_reduction[states];
+    lookaheads->sets = arenaAlloc(arena, ((size_t)lookaheads->reductions_count * words + 1) * sizeof(uint64_t));
+    memset(lookaheads->sets, 0, (size_t)lookaheads->reductions_count * words * sizeof(uint64_t));
+
+    // nodi: le transizioni sui non terminali, indicizzate anche per (stato, posizione della transizione)
+    int* firstTransition = arenaAlloc(arena, (states + 1) * sizeof(int));
+    firstTransition[0] = 0;
+    for (int state=0; state<states; state++){
+        firstTransition[state + 1] = firstTransition[state] + automa->states[state].transition_count;
+    }
+    int* transitionNode = arenaAlloc(arena, (firstTransition[states] + 1) * sizeof(int));
+    int nodes = 0;
+    for (int state=0; state<states; state++){
+        struct automa_state* automaState = &automa->states[state];
+        for (int tr=0; tr<automaState->transition_count; tr++){
+            transitionNode[firstTransition[state] + tr] = isNonTerminal(grammar, automaState->transitions[tr].by) ? nodes++ : -1;
+        }
+    }
+    int* nodeState = arenaAlloc(arena, (nodes + 1) * sizeof(int));
+    int* nodeTransition = arenaAlloc(arena, (nodes + 1) * sizeof(int));
+    for (int state=0; state<states; state++){
+        for (int tr=0; tr<automa->states[state].transition_count; tr++){
+            int node = transitionNode[firstTransition[state] + tr];
+            if (node != -1){
+                nodeState[node] = state;
+                nodeTransition[node] = tr;
+            }
+        }
+    }
+    lookaheads->nonterminal_transitions = nodes;
+
+    // DR e reads
+    uint64_t* follow = arenaAlloc(arena, ((size_t)nodes * words + 1) * sizeof(uint64_t));
+    memset(follow, 0, (size_t)nodes * words * sizeof(uint64_t));
+    int edgesCapacity = nodes + 16, edges = 0;
+    int* from = arenaAlloc(arena, edgesCapacity * sizeof(int));
+    int* to = arenaAlloc(arena, edgesCapacity * sizeof(int));
+
+    for (int node=0; node<nodes; node++){
+        int destination = automa->states[nodeState[node]].transitions[nodeTransition[node]].destination;
+        struct automa_state* target = &automa->states[destination];
+        uint64_t* set = &follow[node * words];
+
+        if (nodeState[node] == 0 && automa->states[0].transitions[nodeTransition[node]].by == grammar->productions[0].body[0]){
+            set[grammar->end_of_input / 64] |= (uint64_t)1 << (grammar->end_of_input % 64);
+        }
+        for (int tr=0; tr<target->transition_count; tr++){
+            int symbol = target->transitions[tr].by;
+            if (!isNonTerminal(grammar, symbol)){
+                set[symbol / 64] |= (uint64_t)1 << (symbol % 64);
+            }else if (nullable[nonTerminalIndex(grammar, symbol)]){
+                int oldCapacity = edgesCapacity;
+                ensureCapacity(arena, (void**)&from, &oldCapacity, edges + 1, sizeof(int));
+                ensureCapacity(arena, (void**)&to, &edgesCapacity, edges + 1, sizeof(int));
+                from[edges] = node;
+                to[edges++] = transitionNode[firstTransition[destination] + tr];
+            }
+        }
+    }
+
+    struct relation reads;
+    buildRelation(&reads, arena, nodes, from, to, edges);
+    lookaheads->reads_edges = edges;
+    if (naivePropagation){
+        propagateNaive(&reads, follow, words);
+    }else{
+        digraph(&reads, follow, words, arena);
+    }
+
+    // includes e lookback, percorrendo dallo stato p il body di ogni produzione del non terminale della transizione
+    int lookbackCapacity = nodes + 16, lookbacks = 0;
+    int* lookbackReduction = arenaAlloc(arena, lookbackCapacity * sizeof(int));
+    int* lookbackNode = arenaAlloc(arena, lookbackCapacity * sizeof(int));
+    int maxBody = 1;
+    for (int t=0; t<grammar->productions_count; t++){
+        if (grammar->productions[t].body_length + 1 > maxBody){
+            maxBody = grammar->productions[t].body_length + 1;
+        }
+    }
+    int* path = arenaAlloc(arena, maxBody * sizeof(int));
+    edges = 0;
+
+    for (int node=0; node<nodes; node++){
+        int driver = automa->states[nodeState[node]].transitions[nodeTransition[node]].by;
+        int n = nonTerminalIndex(grammar, driver);
+
+        for (int k=grammar->nonterminal_first_production[n]; k<grammar->nonterminal_first_production[n + 1]; k++){
+            struct production* production = &grammar->productions[grammar->nonterminal_productions[k]];
+
+            path[0] = nodeState[node];
+            for (int i=0; i<production->body_length; i++){
+                struct automa_state* state = &automa->states[path[i]];
+                path[i + 1] = state->transitions[findTransition(state, production->body[i])].destination;
+            }
+
+            // lookback: la riduzione della produzione nello stato raggiunto
+            struct automa_state* last = &automa->states[path[production->body_length]];
+            int reduction = lookaheads->first_reduction[path[production->body_length]];
+            for (int i=0; i<last->items_count; i++){
+                lr0_item item = last->items[i];
+                if (itemMarker(item) == grammar->productions[itemProduction(item)].body_length){
+                    if (itemProduction(item) == production->production_id){
+                        break;
+                    }
+                    reduction++;
+                }
+            }
+            int oldCapacity = lookbackCapacity;
+            ensureCapacity(arena, (void**)&lookbackReduction, &oldCapacity, lookbacks + 1, sizeof(int));
+            ensureCapacity(arena, (void**)&lookbackNode, &lookbackCapacity, lookbacks + 1, sizeof(int));
+            lookbackReduction[lookbacks] = reduction;
+            lookbackNode[lookbacks++] = node;
+
+            // includes: i non terminali del body seguiti da un suffisso annullabile
+            for (int i=production->body_length - 1; i>=0; i--){
+                int symbol = production->body[i];
+                if (!isNonTerminal(grammar, symbol)){
+                    break;
+                }
+                struct automa_state* state = &automa->states[path[i]];
+                oldCapacity = edgesCapacity;
+                ensureCapacity(arena, (void**)&from, &oldCapacity, edges + 1, sizeof(int));
+                ensureCapacity(arena, (void**)&to, &edgesCapacity, edges + 1, sizeof(int));
+                from[edges] = transitionNode[firstTransition[path[i]] + findTransition(state, symbol)];
+                to[edges++] = node;
+                if (!nullable[nonTerminalIndex(grammar, symbol)]){
+                    break;
+                }
+            }
+        }
+    }
+
+    struct relation includes;
+    buildRelation(&includes, arena, nodes, from, to, edges);
+    lookaheads->includes_edges = edges;
+    if (naivePropagation){
+        propagateNaive(&includes, follow, words);
+    }else{
+        digraph(&includes, follow, words, arena);
+    }
+
+    for (int l=0; l<lookbacks; l++){
+        unionBitset(&lookaheads->sets[(size_t)lookbackReduction[l] * words], &follow[(size_t)lookbackNode[l] * words], words);
+    }
+}
+
+/////////////////////////////// ANALISI DEI CONFLITTI //////////////////////////////
+
+/**
+* Prepara l'analisi dei conflitti di tipo "kind" per la grammatica (finalizzata): per le SLR calcola FOLLOW.
+* L'analisi va collegata all'automa (automa->conflicts) prima della costruzione e conclusa con
+* finishConflictAnalysis.
+*/
+void initConflictAnalysis(struct conflict_analysis* analysis, struct grammar* grammar, table_kind kind, bool failFast, struct arena* arena){
+    int terminals = grammar->symbols.terminals_count;
+    int words = (terminals + 63) / 64;
+
+    memset(analysis, 0, sizeof(struct conflict_analysis));
+    analysis->kind = kind;
+    analysis->fail_fast = failFast;
+    analysis->words = words;
+    analysis->first_conflict_state = -1;
+    analysis->arena = arena;
+
+    analysis->all_terminals = arenaAlloc(arena, words * sizeof(uint64_t));
+    analysis->end_of_input = arenaAlloc(arena, words * sizeof(uint64_t));
+    analysis->scratch_shift = arenaAlloc(arena, words * sizeof(uint64_t));
+    analysis->scratch_reduced = arenaAlloc(arena, words * sizeof(uint64_t));
+    memset(analysis->all_terminals, 0, words * sizeof(uint64_t));
+    memset(analysis->end_of_input, 0, words * sizeof(uint64_t));
+    for (int t=0; t<terminals; t++){
+        setBit(analysis->all_terminals, t);
+    }
+    setBit(analysis->end_of_input, grammar->end_of_input);
+
+    if (kind == slr_tables){
+        struct grammar_sets sets;
+        computeGrammarSets(grammar, &sets, arena);
+        analysis->follow = sets.follow;
+    }
+}
+
+/**
+* Controlla gli stati non ancora controllati durante la costruzione (tutti con LALR(1), con -j, con la cache o
+* con --edit). Con fail_fast il controllo si ferma al primo stato con conflitti.
+*/
+void finishConflictAnalysis(struct conflict_analysis* analysis, struct automa* automa){
+    if (analysis->aborted){
+        return;
+    }
+
+    if (analysis->kind == lalr_tables){
+        struct lalr_lookaheads lookaheads;
+        computeLalrLookaheads(&lookaheads, automa, false, analysis->arena);
+        analysis->lalr_sets = lookaheads.sets;
+        analysis->first_reduction = lookaheads.first_reduction;
+    }
+
+    for (; analysis->checked_states < automa->states_count; analysis->checked_states++){
+        if (checkStateConflicts(analysis, automa, analysis->checked_states) > 0 && analysis->fail_fast){
+            analysis->checked_states++;
+            break;
+        }
+    }
+}
+
+void printConflictItem(FILE* out, struct grammar* grammar, lr0_item item, const char* role){
+    struct production* production = &grammar->productions[itemProduction(item)];
+    int printed = fprintf(out, "    %s -> ", symbolName(grammar, production->driver));
+    printed += printBody(out, grammar, production, itemMarker(item));
+    fprintf(out, printed < 12 ? "\t\t(%s)\n" : "\t(%s)\n", role);
+}
+
+/**
+* Stampa i conflitti trovati con gli item coinvolti: per uno shift/reduce l'item di riduzione e gli item con il
+* marker prima di uno dei terminali in conflitto, per un reduce/reduce i due item di riduzione
+*/
+void printConflicts(FILE* out, struct conflict_analysis* analysis, struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+
+    fprintf(out, "=============== CONFLITTI ===============\n");
+    for (int c=0; c<analysis->conflicts_count; c++){
+        struct conflict* conflict = &analysis->conflicts[c];
+        fprintf(out, "Stato %d: %s su {", conflict->state, conflict->reduce_reduce ? "reduce/reduce" : "shift/reduce");
+        bool separator = false;
+        for (int t=0; t<grammar->symbols.terminals_count; t++){
+            if (testBit(conflict->terminals, t)){
+                fprintf(out, "%s %s", separator ? "," : "", symbolName(grammar, t));
+                separator = true;
+            }
+        }
+        fprintf(out, " }\n");
+
+        printConflictItem(out, grammar, conflict->reduce, "riduzione");
+        if (conflict->reduce_reduce){
+            printConflictItem(out, grammar, conflict->other_reduce, "riduzione");
+            continue;
+        }
+        struct automa_state* state = &automa->states[conflict->state];
+        for (int i=0; i<state->items_count; i++){
+            int symbol = symbolAfterMarker(grammar, state->items[i]);
+            if (symbol != NO_SYMBOL && !isNonTerminal(grammar, symbol) && testBit(conflict->terminals, symbol)){
+                printConflictItem(out, grammar, state->items[i], "shift");
+            }
+        }
+    }
+
+    if (analysis->aborted){
+        fprintf(out, "Costruzione interrotta allo stato %d (fail-fast)\n", analysis->first_conflict_state);
+    }
+    if (analysis->conflicts_count == 0){
+        fprintf(out, "Nessun conflitto %s\n", tableKindName(analysis->kind));
+    }else{
+        fprintf(out, "Conflitti %s: %d in %d stati\n", tableKindName(analysis->kind), analysis->conflicts_count, analysis->conflicting_states);
+    }
+}
+
+/**
+* Inserisce la entry "action" in ACTION[state][terminal]; se la entry e' gia occupata da un'azione diversa
+* si registra un conflitto e si mantiene lo shift oppure la riduzione della produzione con id minore
+*/
+void setAction(struct parse_tables* tables, int state, int terminal, int action){
+    int* entry = &tables->action[state * tables->terminals_count + terminal];
+
+    if (*entry == ACTION_ERROR){
+        *entry = action;
+    }else if (*entry != action){
+        tables->conflicts++;
+        if (actionType(action) == ACTION_SHIFT || (actionType(*entry) == ACTION_REDUCE && actionType(action) == ACTION_REDUCE && actionArgument(action) < actionArgument(*entry))){
+            *entry = action;
+        }
+    }
+}
+
+/**
+* Comprime la tabella densa "table" (rows x columns) con il row displacement: le righe, in ordine di numero
+* di entry non vuote decrescente, vengono sovrapposte nella prima posizione in cui non collidono con le precedenti
+*/
+void packCombTable(struct arena* arena, struct comb_table* comb, int* table, int rows, int columns, int emptyValue){
+    int* order = arenaAlloc(arena, rows * sizeof(int));
+    int* filled = arenaAlloc(arena, rows * sizeof(int));
+
+    memset(comb, 0, sizeof(struct comb_table));
+    comb->rows = rows;
+    comb->base = arenaAlloc(arena, rows * sizeof(int));
+
+    for (int r=0; r<rows; r++){
+        order[r] = r;
+        filled[r] = 0;
+        for (int c=0; c<columns; c++){
+            if (table[r * columns + c] != emptyValue){
+                filled[r]++;
+            }
+        }
+    }
+
+    // insertion sort stabile per numero di entry decrescente
+    for (int i=1; i<rows; i++){
+        int row = order[i];
+        int j = i - 1;
+        while (j >= 0 && filled[order[j]] < filled[row]){
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = row;
+    }
+
+    for (int i=0; i<rows; i++){
+        int row = order[i];
+        int* entries = &table[row * columns];
+
+        if (filled[row] == 0){
+            comb->base[row] = 0; // nessuna entry: il check non corrispondera' mai
+            continue;
+        }
+
+        int base = 0;
+        for (;; base++){
+            bool fits = true;
+            for (int c=0; c<columns && fits; c++){
+                if (entries[c] != emptyValue && base + c < comb->length && comb->check[base + c] != -1){
+                    fits = false;
+                }
+            }
+            if (fits){
+                break;
+            }
+        }
+
+        int required = base + columns;
+        if (required > comb->length){
+            int oldCapacity = comb->capacity;
+            ensureCapacity(arena, (void**)&comb->values, &oldCapacity, required, sizeof(int));
+            ensureCapacity(arena, (void**)&comb->check, &comb->capacity, required, sizeof(int));
+            for (int k=comb->length; k<required; k++){
+                comb->values[k] = emptyValue;
+                comb->check[k] = -1;
+            }
+        }
+
+        comb->base[row] = base;
+        for (int c=0; c<columns; c++){
+            if (entries[c] != emptyValue){
+                comb->values[base + c] = entries[c];
+                comb->check[base + c] = row;
+            }
+        }
+        if (base + columns > comb->length){
+            // la lunghezza utile termina all'ultima entry occupata
+            int last = base + columns - 1;
+            while (last >= 0 && comb->check[last] == -1){
+                last--;
+            }
+            if (last + 1 > comb->length){
+                comb->length = last + 1;
+            }
+        }
+    }
+}
+
+/**
+* Ritorna la entry (row, column) della tabella compressa oppure emptyValue se e' vuota
+*/
+static inline int combLookup(struct comb_table* comb, int row, int column, int emptyValue){
+    int index = comb->base[row] + column;
+    if (index < comb->length && comb->check[index] == row){
+        return comb->values[index];
+    }
+    return emptyValue;
+}
+
+/**
+* Ritorna la dimensione in byte di una entry: 2 byte se tutti i valori stanno in un intero a 16 bit, altrimenti 4
+*/
+int entryBytes(struct parse_tables* tables){
+    int maxValue = makeAction(ACTION_ACCEPT, tables->states_count > tables->nonterminals_count ? tables->states_count : tables->nonterminals_count);
+    return maxValue < 32768 ? 2 : 4;
+}
+
+size_t combTableBytes(struct comb_table* comb, int entryBytes){
+    return (size_t)comb->rows * sizeof(int) + (size_t)comb->length * (entryBytes + sizeof(int));
+}
+
+/**
+* Raggruppa le righe identiche della tabella densa "table" (rows x columns): rowMap[r] riceve l'indice della riga
+* distinta uguale alla riga r e le righe distinte vengono copiate in *unique nell'ordine della prima occorrenza
+*
+* Ritorna: il numero di righe distinte
+*/
+int deduplicateRows(struct arena* arena, int* table, int rows, int columns, int* rowMap, int** unique){
+    int slotsCount = 1;
+    while (slotsCount < 2 * rows){
+        slotsCount *= 2;
+    }
+    int* slots = arenaAlloc(arena, slotsCount * sizeof(int)); // indice della riga distinta oppure -1
+    memset(slots, -1, slotsCount * sizeof(int));
+    *unique = arenaAlloc(arena, (size_t)rows * columns * sizeof(int));
+
+    int count = 0;
+    for (int r=0; r<rows; r++){
+        int* row = &table[(size_t)r * columns];
+        unsigned int slot = hashBytes(14695981039346656037u, row, columns * sizeof(int)) & (slotsCount - 1);
+        while (slots[slot] != -1 && memcmp(&(*unique)[(size_t)slots[slot] * columns], row, columns * sizeof(int)) != 0){
+            slot = (slot + 1) & (slotsCount - 1);
+        }
+        if (slots[slot] == -1){
+            slots[slot] = count;
+            memcpy(&(*unique)[(size_t)count * columns], row, columns * sizeof(int));
+            count++;
+        }
+        rowMap[r] = slots[slot];
+    }
+    return count;
+}
+
+/**
+* Costruisce le forme compresse delle tabelle dense: riduzioni di default e row displacement. Con shareRows gli
+* stati con righe ACTION (o GOTO) identiche condividono un'unica riga delle tabelle compresse.
+*/
+void compressParseTables(struct parse_tables* tables, struct arena* arena, bool shareRows){
+    int terminals = tables->terminals_count;
+    int nonTerminals = tables->nonterminals_count;
+    int states = tables->states_count;
+
+    // riduzioni di default: per ogni stato la riduzione piu' frequente sostituisce tutte le sue occorrenze nella riga
+    tables->default_reduction = arenaAlloc(arena, states * sizeof(int));
+    int* actionWithoutDefaults = arenaAlloc(arena, states * terminals * sizeof(int));
+    memcpy(actionWithoutDefaults, tables->action, states * terminals * sizeof(int));
+
+    for (int state=0; state<states; state++){
+        int* row = &actionWithoutDefaults[state * terminals];
+        int bestReduce = ACTION_ERROR;
+        int bestCount = 0;
+
+        for (int t=0; t<terminals; t++){
+            if (actionType(row[t]) == ACTION_REDUCE && row[t] != bestReduce){
+                int count = 0;
+                for (int k=0; k<terminals; k++){
+                    count += row[k] == row[t];
+                }
+                if (count > bestCount){
+                    bestCount = count;
+                    bestReduce = row[t];
+                }
+            }
+        }
+
+        tables->default_reduction[state] = bestReduce;
+        if (bestReduce != ACTION_ERROR){
+            for (int t=0; t<terminals; t++){
+                if (row[t] == bestReduce){
+                    row[t] = ACTION_ERROR;
+                }
+            }
+        }
+    }
+
+    tables->action_row = arenaAlloc(arena, states * sizeof(int));
+    tables->goto_row = arenaAlloc(arena, states * sizeof(int));
+    for (int state=0; state<states; state++){
+        tables->action_row[state] = state;
+        tables->goto_row[state] = state;
+    }
+    tables->shared_action_rows = false;
+    tables->shared_goto_rows = false;
+
+    packCombTable(arena, &tables->action_comb, tables->action, states, terminals, ACTION_ERROR);
+    packCombTable(arena, &tables->action_default_comb, actionWithoutDefaults, states, terminals, ACTION_ERROR);
+    packCombTable(arena, &tables->goto_comb, tables->goto_table, states, nonTerminals, EMPTY_ENTRY);
+    if (!shareRows){
+        return;
+    }
+
+    // le righe identiche vengono condivise solo se il risparmio supera il costo dell'indice di riga di ogni stato
+    int bytes = entryBytes(tables);
+    int* rowMap = arenaAlloc(arena, states * sizeof(int));
+    int* uniqueRows;
+    int count = deduplicateRows(arena, tables->action, states, terminals, rowMap, &uniqueRows);
+    for (int state=0; state<states; state++){ // due stati con la stessa riga ACTION hanno anche la stessa riga senza default
+        memmove(&actionWithoutDefaults[rowMap[state] * terminals], &actionWithoutDefaults[state * terminals], terminals * sizeof(int));
+    }
+    struct comb_table shared;
+    packCombTable(arena, &shared, actionWithoutDefaults, count, terminals, ACTION_ERROR);
+    if (combTableBytes(&shared, bytes) + (size_t)states * bytes < combTableBytes(&tables->action_default_comb, bytes)){
+        tables->action_default_comb = shared;
+        packCombTable(arena, &tables->action_comb, uniqueRows, count, terminals, ACTION_ERROR);
+        tables->action_row = rowMap;
+        tables->shared_action_rows = true;
+    }
+
+    rowMap = arenaAlloc(arena, states * sizeof(int));
+    count = deduplicateRows(arena, tables->goto_table, states, nonTerminals, rowMap, &uniqueRows);
+    packCombTable(arena, &shared, uniqueRows, count, nonTerminals, EMPTY_ENTRY);
+    if (combTableBytes(&shared, bytes) + (size_t)states * bytes < combTableBytes(&tables->goto_comb, bytes)){
+        tables->goto_comb = shared;
+        tables->goto_row = rowMap;
+        tables->shared_goto_rows = true;
+    }
+}
+
+/**
+* Costruisce le tabelle ACTION e GOTO LR(0), SLR o LALR(1) a partire dall'automa caratteristico e le relative forme
+* compresse. Nelle tabelle LR(0) un item di riduzione riduce su ogni terminale, nelle SLR solo sui terminali del
+* FOLLOW del driver e nelle LALR(1) solo sui lookahead della riduzione in quello stato.
+*/
+void buildParseTables(struct parse_tables* tables, struct automa* automa, table_kind kind, struct arena* arena){
+    struct grammar* grammar = automa->grammar;
+    int terminals = grammar->symbols.terminals_count;
+    int nonTerminals = nonTerminalsCount(grammar);
+    int words = (terminals + 63) / 64;
+    int states = automa->states_count;
+
+    tables->kind = kind;
+    tables->states_count = states;
+    tables->terminals_count = terminals;
+    tables->nonterminals_count = nonTerminals;
+    tables->conflicts = 0;
+    tables->action = arenaAlloc(arena, states * terminals * sizeof(int));
+    tables->goto_table = arenaAlloc(arena, states * nonTerminals * sizeof(int));
+    for (int i=0; i<states * terminals; i++){
+        tables->action[i] = ACTION_ERROR;
+    }
+    for (int i=0; i<states * nonTerminals; i++){
+        tables->goto_table[i] = EMPTY_ENTRY;
+    }
+
+    struct grammar_sets sets;
+    if (kind == slr_tables){
+        computeGrammarSets(grammar, &sets, arena);
+    }
+    struct lalr_lookaheads lookaheads;
+    if (kind == lalr_tables){
+        computeLalrLookaheads(&lookaheads, automa, false, arena);
+    }
+
+    for (int state=0; state<states; state++){
+        struct automa_state* automaState = &automa->states[state];
+
+        for (int tr=0; tr<automaState->transition_count; tr++){
+            struct transition* transition = &automaState->transitions[tr];
+            if (isNonTerminal(grammar, transition->by)){
+                tables->goto_table[state * nonTerminals + nonTerminalIndex(grammar, transition->by)] = transition->destination;
+            }else{
+                setAction(tables, state, transition->by, makeAction(ACTION_SHIFT, transition->destination));
+            }
+        }
+
+        int reduction = kind == lalr_tables ? lookaheads.first_reduction[state] : 0;
+        for (int i=0; i<automaState->items_count; i++){
+            lr0_item item = automaState->items[i];
+            struct production* production = &grammar->productions[itemProduction(item)];
+            if (itemMarker(item) != production->body_length){
+                continue;
+            }
+            reduction++;
+
+            if (production->production_id == 0){ // K -> S. : accept sul terminale di fine input
+                setAction(tables, state, grammar->end_of_input, makeAction(ACTION_ACCEPT, 0));
+                continue;
+            }
+
+            int reduce = makeAction(ACTION_REDUCE, production->production_id);
+            uint64_t* lookahead = NULL;
+            if (kind == slr_tables){
+                lookahead = &sets.follow[nonTerminalIndex(grammar, production->driver) * words];
+            }else if (kind == lalr_tables){
+                lookahead = &lookaheads.sets[(size_t)(reduction - 1) * words];
+            }
+            for (int terminal=0; terminal<terminals; terminal++){
+                if (lookahead == NULL || (lookahead[terminal / 64] >> (terminal % 64)) & 1){
+                    setAction(tables, state, terminal, reduce);
+                }
+            }
+        }
+    }
+
+    compressParseTables(tables, arena, false);
+}
+
+/**
+* Ritorna la entry ACTION[state][terminal] leggendo la forma compressa con riduzioni di default
+*/
+int lookupAction(struct parse_tables* tables, int state, int terminal){
+    int action = combLookup(&tables->action_default_comb, tables->action_row[state], terminal, ACTION_ERROR);
+    return action != ACTION_ERROR ? action : tables->default_reduction[state];
+}
+
+/**
+* Ritorna lo stato GOTO[state][nonTerminal] (nonTerminal e' l'indice del non terminale) dalla forma compressa
+*/
+int lookupGoto(struct parse_tables* tables, int state, int nonTerminal){
+    return combLookup(&tables->goto_comb, tables->goto_row[state], nonTerminal, EMPTY_ENTRY);
+}
+
+/**
+* Dimensione in byte delle tabelle compresse con row displacement, con o senza riduzioni di default; con le righe
+* condivise si aggiungono gli indici di riga ACTION o GOTO di ogni stato
+*/
+size_t compressedTablesBytes(struct parse_tables* tables, bool defaultReductions){
+    int bytes = entryBytes(tables);
+    size_t total = combTableBytes(&tables->goto_comb, bytes);
+    if (defaultReductions){
+        total += combTableBytes(&tables->action_default_comb, bytes) + (size_t)tables->states_count * bytes;
+    }else{
+        total += combTableBytes(&tables->action_comb, bytes);
+    }
+    if (tables->shared_action_rows){
+        total += (size_t)tables->states_count * bytes;
+    }
+    if (tables->shared_goto_rows){
+        total += (size_t)tables->states_count * bytes;
+    }
+    return total;
+}
+
+/**
+* Hash delle righe ACTION e GOTO dello stato in cui gli stati destinazione sono sostituiti dalla loro classe
+*/
+uint64_t stateBehaviourHash(struct parse_tables* tables, int* stateClass, int state){
+    uint64_t hash = 14695981039346656037u ^ (uint64_t)stateClass[state];
+    int* action = &tables->action[(size_t)state * tables->terminals_count];
+    int* gotoRow = &tables->goto_table[(size_t)state * tables->nonterminals_count];
+
+    for (int t=0; t<tables->terminals_count; t++){
+        int entry = actionType(action[t]) == ACTION_SHIFT ? makeAction(ACTION_SHIFT, stateClass[actionArgument(action[t])]) : action[t];
+        hash = (hash ^ (uint32_t)entry) * 1099511628211u;
+    }
+    for (int n=0; n<tables->nonterminals_count; n++){
+        int entry = gotoRow[n] != EMPTY_ENTRY ? stateClass[gotoRow[n]] : EMPTY_ENTRY;
+        hash = (hash ^ (uint32_t)entry) * 1099511628211u;
+    }
+    return hash;
+}
+
+/**
+* Ritorna true se gli stati a e b sono nella stessa classe e hanno le stesse righe ACTION e GOTO a meno della
+* classe degli stati destinazione
+*/
+bool sameStateBehaviour(struct parse_tables* tables, int* stateClass, int a, int b){
+    if (stateClass[a] != stateClass[b]){
+        return false;
+    }
+
+    int terminals = tables->terminals_count;
+    int nonTerminals = tables->nonterminals_count;
+    for (int t=0; t<terminals; t++){
+        int x = tables->action[(size_t)a * terminals + t];
+        int y = tables->action[(size_t)b * terminals + t];
+        if (actionType(x) == ACTION_SHIFT && actionType(y) == ACTION_SHIFT){
+            if (stateClass[actionArgument(x)] != stateClass[actionArgument(y)]){
+                return false;
+            }
+        }else if (x != y){
+            return false;
+        }
+    }
+    for (int n=0; n<nonTerminals; n++){
+        int x = tables->goto_table[(size_t)a * nonTerminals + n];
+        int y = tables->goto_table[(size_t)b * nonTerminals + n];
+        if (x != y && (x == EMPTY_ENTRY || y == EMPTY_ENTRY || stateClass[x] != stateClass[y])){
+            return false;
+        }
+    }
+    return true;
+}
+
+int compareKeys(const void* a, const void* b){
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+* Ottimizza le tabelle gia' costruite in tre passi:
+*  1. unisce gli stati equivalenti, cioe' con le stesse azioni e gli stessi GOTO a meno di stati destinazione a loro
+*     volta equivalenti: il parser non puo' distinguerli, quindi accetta lo stesso linguaggio e rileva gli errori
+*     sugli stessi token. Le classi si ottengono raffinando la partizione come nella minimizzazione di un DFA;
+*  2. rinumera gli stati mettendo per primi quelli referenziati da piu' entry (shift e GOTO), cosi' le righe degli
+*     stati piu' frequentati sono vicine; lo stato iniziale resta 0;
+*  3. ricostruisce le forme compresse condividendo le righe ACTION e GOTO identiche.
+*/
+void optimizeParseTables(struct parse_tables* tables, struct arena* arena, struct table_optimization* report){
+    int states = tables->states_count;
+    int terminals = tables->terminals_count;
+    int nonTerminals = tables->nonterminals_count;
+
+    report->states_before = states;
+    report->bytes_before = compressedTablesBytes(tables, true);
+
+    // 1. raffinamento: si parte da un'unica classe e si separano gli stati con righe diverse finche' il numero di
+    // classi non cambia piu'. Le classi sono numerate nell'ordine del primo stato, quindi lo stato 0 e' nella classe 0
+    int* stateClass = arenaAlloc(arena, states * sizeof(int));
+    int* nextClass = arenaAlloc(arena, states * sizeof(int));
+    memset(stateClass, 0, states * sizeof(int));
+    int slotsCount = 1;
+    while (slotsCount < 2 * states){
+        slotsCount *= 2;
+    }
+    int* slots = arenaAlloc(arena, slotsCount * sizeof(int)); // primo stato della classe oppure -1
+
+    int classes = 1;
+    report->refinement_rounds = 0;
+    for (;;){
+        report->refinement_rounds++;
+        memset(slots, -1, slotsCount * sizeof(int));
+        int count = 0;
+        for (int state=0; state<states; state++){
+            unsigned int slot = stateBehaviourHash(tables, stateClass, state) & (slotsCount - 1);
+            while (slots[slot] != -1 && !sameStateBehaviour(tables, stateClass, slots[slot], state)){
+                slot = (slot + 1) & (slotsCount - 1);
+            }
+            if (slots[slot] == -1){
+                slots[slot] = state;
+                nextClass[state] = count++;
+            }else{
+                nextClass[state] = nextClass[slots[slot]];
+            }
+        }
+
+        int* swap = stateClass;
+        stateClass = nextClass;
+        nextClass = swap;
+        if (count == classes){
+            break;
+        }
+        classes = count;
+    }
+
+    int* representative = arenaAlloc(arena, classes * sizeof(int));
+    for (int state=states - 1; state>=0; state--){
+        representative[stateClass[state]] = state;
+    }
+
+    // 2. rinumerazione: chiave (riferimenti decrescenti, classe) e classe 0 sempre per prima
+    int* references = arenaAlloc(arena, classes * sizeof(int));
+    memset(references, 0, classes * sizeof(int));
+    for (int c=0; c<classes; c++){
+        int state = representative[c];
+        for (int t=0; t<terminals; t++){
+            int entry = tables->action[(size_t)state * terminals + t];
+            if (actionType(entry) == ACTION_SHIFT){
+                references[stateClass[actionArgument(entry)]]++;
+            }
+        }
+        for (int n=0; n<nonTerminals; n++){
+            int destination = tables->goto_table[(size_t)state * nonTerminals + n];
+            if (destination != EMPTY_ENTRY){
+                references[stateClass[destination]]++;
+            }
+        }
+    }
+
+    uint64_t* keys = arenaAlloc(arena, classes * sizeof(uint64_t));
+    for (int c=0; c<classes; c++){
+        uint32_t heat = c == 0 ? UINT32_MAX : (uint32_t)references[c];
+        keys[c] = ((uint64_t)(UINT32_MAX - heat) << 32) | (uint32_t)c;
+    }
+    qsort(keys, classes, sizeof(uint64_t), compareKeys);
+    int* newId = arenaAlloc(arena, classes * sizeof(int));
+    for (int i=0; i<classes; i++){
+        newId[(uint32_t)keys[i]] = i;
+    }
+
+    int* action = arenaAlloc(arena, (size_t)classes * terminals * sizeof(int));
+    int* gotoTable = arenaAlloc(arena, (size_t)classes * nonTerminals * sizeof(int));
+    for (int c=0; c<classes; c++){
+        int state = representative[c];
+        int* actionRow = &action[(size_t)newId[c] * terminals];
+        int* gotoRow = &gotoTable[(size_t)newId[c] * nonTerminals];
+
+        for (int t=0; t<terminals; t++){
+            int entry = tables->action[(size_t)state * terminals + t];
+            actionRow[t] = actionType(entry) == ACTION_SHIFT ? makeAction(ACTION_SHIFT, newId[stateClass[actionArgument(entry)]]) : entry;
+        }
+        for (int n=0; n<nonTerminals; n++){
+            int destination = tables->goto_table[(size_t)state * nonTerminals + n];
+            gotoRow[n] = destination != EMPTY_ENTRY ? newId[stateClass[destination]] : EMPTY_ENTRY;
+        }
+    }
+
+    // 3. forme compresse con righe condivise
+    tables->action = action;
+    tables->goto_table = gotoTable;
+    tables->states_count = classes;
+    compressParseTables(tables, arena, true);
+
+    report->states_after = classes;
+    report->action_rows = tables->action_default_comb.rows;
+    report->goto_rows = tables->goto_comb.rows;
+    report->bytes_after = compressedTablesBytes(tables, true);
+}
+
+void printTableOptimization(FILE* out, struct table_optimization* report){
+    fprintf(out, "========= OTTIMIZZAZIONE TABELLE =========\n");
+    fprintf(out, "stati                  : %d -> %d (%d iterazioni di raffinamento)\n", report->states_before, report->states_after, report->refinement_rounds);
+    fprintf(out, "righe memorizzate      : %d ACTION, %d GOTO\n", report->action_rows, report->goto_rows);
+    fprintf(out, "tabelle compresse      : %zu -> %zu byte\n", report->bytes_before, report->bytes_after);
+}
+
+void printActionEntry(FILE* out, int action){
+    char entry[16] = "";
+    switch (actionType(action)){
+        case ACTION_SHIFT: sprintf(entry, "s%d", actionArgument(action)); break;
+        case ACTION_REDUCE: sprintf(entry, "r%d", actionArgument(action)); break;
+        case ACTION_ACCEPT: sprintf(entry, "acc"); break;
+    }
+    fprintf(out, " %6s", entry);
+}
+
+void printCombTable(FILE* out, const char* name, struct comb_table* comb){
+    fprintf(out, "%s base :", name);
+    for (int r=0; r<comb->rows; r++) fprintf(out, " %d", comb->base[r]);
+    fprintf(out, "\n%s value:", name);
+    for (int i=0; i<comb->length; i++) fprintf(out, " %d", comb->values[i]);
+    fprintf(out, "\n%s check:", name);
+    for (int i=0; i<comb->length; i++) fprintf(out, " %d", comb->check[i]);
+    fprintf(out, "\n");
+}
+
+/**
+* Stampa le tabelle ACTION/GOTO in forma densa, le forme compresse e la dimensione di ogni codifica
+*/
+void printParseTables(FILE* out, struct parse_tables* tables, struct grammar* grammar){
+    int terminals = tables->terminals_count;
+    int nonTerminals = tables->nonterminals_count;
+
+    fprintf(out, "=========== TABELLE %s ===========\n", tableKindName(tables->kind));
+    fprintf(out, "%6s", "stato");
+    for (int t=0; t<terminals; t++) fprintf(out, " %6s", symbolName(grammar, t));
+    fprintf(out, " |");
+    for (int n=0; n<nonTerminals; n++) fprintf(out, " %6s", symbolName(grammar, terminals + n));
+    fprintf(out, "\n");
+
+    for (int state=0; state<tables->states_count; state++){
+        fprintf(out, "%6d", state);
+        for (int t=0; t<terminals; t++){
+            printActionEntry(out, tables->action[state * terminals + t]);
+        }
+        fprintf(out, " |");
+        for (int n=0; n<nonTerminals; n++){
+            int destination = tables->goto_table[state * nonTerminals + n];
+            if (destination == EMPTY_ENTRY){
+                fprintf(out, " %6s", "");
+            }else{
+                fprintf(out, " %6d", destination);
+            }
+        }
+        fprintf(out, "\n");
+    }
+    if (tables->conflicts > 0){
+        fprintf(out, "Conflitti: %d\n", tables->conflicts);
+    }
+
+    fprintf(out, "=========== TABELLE COMPRESSE ===========\n");
+    fprintf(out, "default:");
+    for (int state=0; state<tables->states_count; state++) fprintf(out, " %d", tables->default_reduction[state]);
+    fprintf(out, "\n");
+    if (tables->shared_action_rows){
+        fprintf(out, "action row:");
+        for (int state=0; state<tables->states_count; state++) fprintf(out, " %d", tables->action_row[state]);
+        fprintf(out, "\n");
+    }
+    if (tables->shared_goto_rows){
+        fprintf(out, "goto row:");
+        for (int state=0; state<tables->states_count; state++) fprintf(out, " %d", tables->goto_row[state]);
+        fprintf(out, "\n");
+    }
+    printCombTable(out, "action", &tables->action_default_comb);
+    printCombTable(out, "goto", &tables->goto_comb);
+
+    int bytes = entryBytes(tables);
+    size_t dense = (size_t)tables->states_count * (terminals + nonTerminals) * bytes;
+    size_t comb = compressedTablesBytes(tables, false);
+    size_t combDefault = compressedTablesBytes(tables, true);
+
+    fprintf(out, "=========== DIMENSIONE TABELLE ===========\n");
+    fprintf(out, "entry da %d byte\n", bytes);
+    fprintf(out, "densa                      : %zu byte\n", dense);
+    fprintf(out, "row displacement           : %zu byte\n", comb);
+    fprintf(out, "row displacement + default : %zu byte\n", combDefault);
+}
+
+
+/////////////////////////////// PARSER //////////////////////////////
+
+void initTokenReader(struct token_reader* reader, struct grammar* grammar, struct arena* arena){
+    reader->source = NULL;
+    reader->length = 0;
+    reader->position = 0;
+    reader->tokens_read = 0;
+    reader->grammar = grammar;
+    reader->arena = arena;
+    reader->word_capacity = 64;
+    reader->word = arenaAlloc(arena, reader->word_capacity);
+
+    for (int c=0; c<256; c++){
+        char name[2] = { (char)c, '\0' };
+        int symbol = c != 0 && !grammar->symbols.multi_character ? findSymbol(grammar, name) : -1;
+        reader->char_terminal[c] = symbol != -1 && !isNonTerminal(grammar, symbol) ? symbol : NO_SYMBOL;
+    }
+}
+
+/**
+* Collega il lettore ad un nuovo input, riutilizzando i buffer gia' allocati
+*/
+void setTokenSource(struct token_reader* reader, FILE* source){
+    reader->source = source;
+    reader->length = 0;
+    reader->position = 0;
+    reader->tokens_read = 0;
+}
+
+/**
+* Ritorna il prossimo carattere dell'input oppure EOF, ricaricando il buffer quando e' esaurito
+*/
+static inline int readChar(struct token_reader* reader){
+    if (reader->position == reader->length){
+        reader->length = fread(reader->buffer, 1, TOKEN_BUFFER_SIZE, reader->source);
+        reader->position = 0;
+        if (reader->length == 0){
+            return EOF;
+        }
+    }
+    return (unsigned char)reader->buffer[reader->position++];
+}
+
+/**
+* Ritorna il terminale del prossimo token, il terminale di fine input se l'input e' terminato oppure NO_SYMBOL se
+* il token non e' un terminale della grammatica
+*/
+int nextToken(struct token_reader* reader){
+    int c = readChar(reader);
+    while (c != EOF && isBlank(c)){
+        c = readChar(reader);
+    }
+    if (c == EOF){
+        return reader->grammar->end_of_input;
+    }
+    reader->tokens_read++;
+
+    if (!reader->grammar->symbols.multi_character){
+        return reader->char_terminal[c];
+    }
+
+    int length = 0;
+    while (c != EOF && !isBlank(c)){
+        if (length + 1 >= reader->word_capacity){
+            ensureCapacity(reader->arena, (void**)&reader->word, &reader->word_capacity, length + 2, 1);
+        }
+        reader->word[length++] = c;
+        c = readChar(reader);
+    }
+    reader->word[length] = '\0';
+
+    int symbol = findSymbol(reader->grammar, reader->word);
+    return symbol != -1 && !isNonTerminal(reader->grammar, symbol) ? symbol : NO_SYMBOL;
+}
+
+void initParser(struct lr_parser* parser, struct parse_tables* tables, struct grammar* grammar, struct arena* arena){
+    parser->tables = tables;
+    parser->arena = arena;
+    parser->reduce_length = arenaAlloc(arena, grammar->productions_count * sizeof(int));
+    parser->reduce_driver = arenaAlloc(arena, grammar->productions_count * sizeof(int));
+    for (int t=0; t<grammar->productions_count; t++){
+        parser->reduce_length[grammar->productions[t].production_id] = grammar->productions[t].body_length;
+        parser->reduce_driver[grammar->productions[t].production_id] = nonTerminalIndex(grammar, grammar->productions[t].driver);
+    }
+
+    parser->stack_capacity = PARSER_STACK_INITIAL_SIZE;
+    parser->stack = arenaAlloc(arena, parser->stack_capacity * sizeof(int));
+    parser->depth = 0;
+}
+
+static inline void pushState(struct lr_parser* parser, int state){
+    if (parser->depth == parser->stack_capacity){
+        ensureCapacity(parser->arena, (void**)&parser->stack, &parser->stack_capacity, parser->depth + 1, sizeof(int));
+    }
+    parser->stack[parser->depth++] = state;
+}
+
+/**
+* Esegue il parsing dei token letti da reader.
+*
+* Ritorna: true se l'input appartiene al linguaggio della grammatica, false altrimenti; in caso di errore
+*          reader->tokens_read e' la posizione del token che ha causato l'errore
+*/
+bool parseInput(struct lr_parser* parser, struct token_reader* reader){
+    struct parse_tables* tables = parser->tables;
+
+    parser->depth = 0;
+    pushState(parser, 0);
+    int token = nextToken(reader);
+
+    while (token != NO_SYMBOL){
+        int action = lookupAction(tables, parser->stack[parser->depth - 1], token);
+
+        switch (actionType(action)){
+            case ACTION_SHIFT:
+                pushState(parser, actionArgument(action));
+                token = nextToken(reader);
+                break;
+
+            case ACTION_REDUCE: {
+                int production = actionArgument(action);
+                parser->depth -= parser->reduce_length[production];
+                pushState(parser, lookupGoto(tables, parser->stack[parser->depth - 1], parser->reduce_driver[production]));
+                break;
+            }
+
+            case ACTION_ACCEPT:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+
+/////////////////////////////// COSTRUZIONE LAZY //////////////////////////////
+
+void initLazyParser(struct lazy_parser* lazy, struct automa* automa, struct grammar* grammar, table_kind kind, struct arena* arena){
+    memset(lazy, 0, sizeof(struct lazy_parser));
+    lazy->automa = automa;
+    lazy->kind = kind;
+
+    initConstruction(automa, grammar);
+    initLazyClosureSets(automa);
+    if (kind == slr_tables){
+        computeGrammarSets(grammar, &lazy->sets, arena);
+    }
+    initParser(&lazy->parser, NULL, grammar, arena);
+}
+
+/**
+* Calcola closure e transizioni dello stato se non sono gia' state calcolate; i successori vengono creati con il
+* solo kernel e saranno espansi a loro volta quando raggiunti
+*/
+void expandLazyState(struct lazy_parser* lazy, int state){
+    struct automa* automa = lazy->automa;
+    if (state < lazy->expanded_capacity && lazy->expanded[state]){
+        return;
+    }
+
+    int oldCapacity = lazy->expanded_capacity;
+    ensureCapacity(automa->arena, (void**)&lazy->expanded, &lazy->expanded_capacity, automa->states_count, sizeof(bool));
+    memset(lazy->expanded + oldCapacity, 0, (lazy->expanded_capacity - oldCapacity) * sizeof(bool));
+    ensureCapacity(automa->arena, (void**)&lazy->expansion_order, &lazy->expansion_order_capacity, lazy->expanded_count + 1, sizeof(int));
+
+    expandState(automa, state);
+    lazy->expanded[state] = true;
+    lazy->expansion_order[lazy->expanded_count++] = state;
+}
+
+/**
+* Ritorna la entry ACTION[state][terminal] calcolata dallo stato espanso con le stesse regole di buildParseTables:
+* lo shift prevale sulle riduzioni e tra due riduzioni prevale quella con id minore
+*/
+int lazyAction(struct lazy_parser* lazy, int state, int terminal){
+    expandLazyState(lazy, state);
+    struct grammar* grammar = lazy->automa->grammar;
+    struct automa_state* automaState = &lazy->automa->states[state];
+
+    int tr = findTransition(automaState, terminal);
+    if (tr != -1){
+        return makeAction(ACTION_SHIFT, automaState->transitions[tr].destination);
+    }
+
+    int action = ACTION_ERROR;
+    for (int i=0; i<automaState->items_count; i++){
+        struct production* production = &grammar->productions[itemProduction(automaState->items[i])];
+        if (itemMarker(automaState->items[i]) != production->body_length){
+            continue;
+        }
+
+        int candidate = ACTION_ERROR;
+        if (production->production_id == 0){
+            candidate = terminal == grammar->end_of_input ? makeAction(ACTION_ACCEPT, 0) : ACTION_ERROR;
+        }else if (lazy->kind == lr0_tables || testBit(&lazy->sets.follow[nonTerminalIndex(grammar, production->driver) * lazy->sets.words], terminal)){
+            candidate = makeAction(ACTION_REDUCE, production->production_id);
+        }
+
+        if (action == ACTION_ERROR){
+            action = candidate;
+        }else if (actionType(action) == ACTION_REDUCE && actionType(candidate) == ACTION_REDUCE && actionArgument(candidate) < actionArgument(action)){
+            action = candidate;
+        }
+    }
+    return action;
+}
+
+/**
+* Ritorna lo stato GOTO[state][nonTerminal] (nonTerminal e' l'indice del non terminale) oppure EMPTY_ENTRY
+*/
+int lazyGoto(struct lazy_parser* lazy, int state, int nonTerminal){
+    expandLazyState(lazy, state);
+    struct automa_state* automaState = &lazy->automa->states[state];
+    int tr = findTransition(automaState, lazy->automa->grammar->symbols.terminals_count + nonTerminal);
+    return tr != -1 ? automaState->transitions[tr].destination : EMPTY_ENTRY;
+}
+
+/**
+* Esegue il parsing dei token letti da reader come parseInput, costruendo gli stati dell'automa quando servono
+*/
+bool parseInputLazy(struct lazy_parser* lazy, struct token_reader* reader){
+    struct lr_parser* parser = &lazy->parser;
+
+    parser->depth = 0;
+    pushState(parser, 0);
+    int token = nextToken(reader);
+
+    while (token != NO_SYMBOL){
+        int action = lazyAction(lazy, parser->stack[parser->depth - 1], token);
+
+        switch (actionType(action)){
+            case ACTION_SHIFT:
+                pushState(parser, actionArgument(action));
+                token = nextToken(reader);
+                break;
+
+            case ACTION_REDUCE: {
+                int production = actionArgument(action);
+                parser->depth -= parser->reduce_length[production];
+                pushState(parser, lazyGoto(lazy, parser->stack[parser->depth - 1], parser->reduce_driver[production]));
+                break;
+            }
+
+            case ACTION_ACCEPT:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+/**
+* Scrive il profilo degli accessi: l'hash della grammatica e gli stati espansi nell'ordine di espansione.
+* Rieseguendo le espansioni nello stesso ordine a partire dallo stato 0 si ottengono gli stessi id di stato.
+*/
+bool writeLazyProfile(struct lazy_parser* lazy, const char* path){
+    FILE* out = fopen(path, "w");
+    if (out == NULL){
+        return false;
+    }
+
+    fprintf(out, "automaGenerator-profile %016llx %d\n", (unsigned long long)hashGrammar(lazy->automa->grammar), lazy->expanded_count);
+    for (int i=0; i<lazy->expanded_count; i++){
+        fprintf(out, "%d\n", lazy->expansion_order[i]);
+    }
+    fclose(out);
+    return true;
+}
+
+/**
+* Espande gli stati elencati nel profilo, nell'ordine in cui erano stati espansi. Il profilo viene ignorato se e'
+* stato registrato con una grammatica diversa; la lettura si interrompe al primo stato che non esiste ancora.
+*
+* Ritorna: false se il profilo non puo' essere letto o non corrisponde alla grammatica
+*/
+bool warmLazyProfile(struct lazy_parser* lazy, const char* path){
+    FILE* source = fopen(path, "r");
+    if (source == NULL){
+        return false;
+    }
+
+    unsigned long long hash;
+    int count;
+    if (fscanf(source, "automaGenerator-profile %llx %d", &hash, &count) != 2 || hash != hashGrammar(lazy->automa->grammar)){
+        fclose(source);
+        return false;
+    }
+
+    int state;
+    for (int i=0; i<count && fscanf(source, "%d", &state) == 1; i++){
+        if (state < 0 || state >= lazy->automa->states_count){
+            break;
+        }
+        expandLazyState(lazy, state);
+    }
+    lazy->warmed_states = lazy->expanded_count;
+    fclose(source);
+    return true;
+}
+
+
+/**
+* Modalita' --lazy: analizza parseFile ("-" per stdin) costruendo solo gli stati dell'automa raggiunti dal parser,
+* dopo aver eventualmente espanso gli stati del profilo; al termine stampa stati espansi, tempi e memoria e, se
+* richiesto, scrive il profilo degli accessi.
+*/
+void runLazyParse(struct automa* automa, struct grammar* grammar, table_kind kind, const char* parseFile, const char* profile, const char* profileOutput, struct arena* arena){
+    FILE* parseSource = strcmp(parseFile, "-") == 0 ? stdin : fopen(parseFile, "r");
+    if (parseSource == NULL){
+        printf("Impossibile aprire il file %s\n", parseFile);
+        return;
+    }
+
+    double start = currentTimeSeconds();
+    struct lazy_parser lazy;
+    initLazyParser(&lazy, automa, grammar, kind, arena);
+    if (profile != NULL && !warmLazyProfile(&lazy, profile)){
+        printf("Il profilo %s non e' leggibile o non corrisponde alla grammatica: ignorato\n", profile);
+    }
+    double startupSeconds = currentTimeSeconds() - start;
+
+    struct token_reader* reader = arenaAlloc(arena, sizeof(struct token_reader));
+    initTokenReader(reader, grammar, arena);
+    setTokenSource(reader, parseSource);
+
+    printf("================ PARSING ================\n");
+    start = currentTimeSeconds();
+    bool accepted = parseInputLazy(&lazy, reader);
+    double parseSeconds = currentTimeSeconds() - start;
+    if (accepted){
+        printf("Input accettato (%ld token)\n", reader->tokens_read);
+    }else{
+        printf("Errore di sintassi al token %ld\n", reader->tokens_read);
+    }
+    if (parseSource != stdin){
+        fclose(parseSource);
+    }
+
+    printf("=========== COSTRUZIONE LAZY %s ===========\n", tableKindName(kind));
+    printf("stati espansi      : %d (%d dal profilo) su %d creati\n", lazy.expanded_count, lazy.warmed_states, automa->states_count);
+    printf("avvio              : %.3f ms\n", startupSeconds * 1e3);
+    printf("parsing            : %.3f ms\n", parseSeconds * 1e3);
+    printf("memoria di picco   : %zu byte\n", arenaPeakBytes(arena));
+
+    if (profileOutput != NULL && !writeLazyProfile(&lazy, profileOutput)){
+        printf("Impossibile scrivere il file %s\n", profileOutput);
+    }
+}
+
+
+/////////////////////////////// PARSER DIRECT-CODED //////////////////////////////
+
+/**
+* Scrive text come stringa C, con i caratteri speciali in forma di escape
+*/
+void emitCString(FILE* out, const char* text){
+    fputc('"', out);
+    for (const unsigned char* c=(const unsigned char*)text; *c != '\0'; c++){
+        if (*c == '"' || *c == '\\'){
+            fprintf(out, "\\%c", *c);
+        }else if (*c < 32 || *c >= 127){
+            fprintf(out, "\\%03o", *c);
+        }else{
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+* Scrive su out il sorgente C di un parser autonomo equivalente alle tabelle "tables": ogni stato diventa un'etichetta
+* con uno switch sul token corrente in cui shift e riduzioni sono codificati direttamente; dopo una riduzione si salta
+* all'etichetta del driver che seleziona lo stato GOTO in base allo stato in cima allo stack.
+* Il programma generato legge l'input da file o da stdin con la stessa suddivisione in token di --parse e
+* non dipende da automaGenerator.c.
+*/
+void emitDirectParser(FILE* out, struct parse_tables* tables, struct grammar* grammar){
+    int terminals = tables->terminals_count;
+    int nonTerminals = tables->nonterminals_count;
+    bool multiCharacter = grammar->symbols.multi_character;
+
+    fprintf(out, "/* Parser LR generato da automaGenerator (tabelle %s, %d stati) */\n", tableKindName(tables->kind), tables->states_count);
+    fprintf(out, "#define _POSIX_C_SOURCE 199309L\n");
+    fprintf(out, "#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n#include <time.h>\n\n");
+    fprintf(out, "#define END_OF_INPUT %d\n#define NO_SYMBOL -1\n#define BUFFER_SIZE 65536\n\n", grammar->end_of_input);
+
+    // associazione token -> terminale
+    if (multiCharacter){
+        int* sorted = malloc(terminals * sizeof(int));
+        for (int t=0; t<terminals; t++){
+            int j = t - 1;
+            while (j >= 0 && strcmp(symbolName(grammar, sorted[j]), symbolName(grammar, t)) > 0){
+                sorted[j + 1] = sorted[j];
+                j--;
+            }
+            sorted[j + 1] = t;
+        }
+
+        fprintf(out, "struct terminal { const char* name; int id; };\n");
+        fprintf(out, "static const struct terminal terminals[%d] = {\n", terminals);
+        for (int t=0; t<terminals; t++){
+            fprintf(out, "    { ");
+            emitCString(out, symbolName(grammar, sorted[t]));
+            fprintf(out, ", %d },\n", sorted[t]);
+        }
+        fprintf(out, "};\n\n");
+        free(sorted);
+    }else{
+        int charTerminal[256];
+        for (int c=0; c<256; c++){
+            charTerminal[c] = NO_SYMBOL;
+        }
+        for (int t=0; t<terminals; t++){
+            const char* name = symbolName(grammar, t);
+            if (name[0] != '\0' && name[1] == '\0'){
+                charTerminal[(unsigned char)name[0]] = t;
+            }
+        }
+
+        fprintf(out, "static const int char_terminal[256] = {");
+        for (int c=0; c<256; c++){
+            fprintf(out, "%s%d,", c % 16 == 0 ? "\n    " : " ", charTerminal[c]);
+        }
+        fprintf(out, "\n};\n\n");
+    }
+
+    // lettura dei token
+    fprintf(out,
+        "static FILE* source;\n"
+        "static char buffer[BUFFER_SIZE];\n"
+        "static size_t length, position;\n"
+        "static long tokens_read;\n\n"
+        "static int* stack;\n"
+        "static size_t depth, capacity;\n\n"
+        "static int readChar(void){\n"
+        "    if (position == length){\n"
+        "        length = fread(buffer, 1, BUFFER_SIZE, source);\n"
+        "        position = 0;\n"
+        "        if (length == 0){\n"
+        "            return EOF;\n"
+        "        }\n"
+        "    }\n"
+        "    return (unsigned char)buffer[position++];\n"
+        "}\n\n"
+        "static int isBlank(int c){\n"
+        "    return c == ' ' || c == '\\t' || c == '\\n' || c == '\\r';\n"
+        "}\n\n");
+
+    if (multiCharacter){
+        fprintf(out,
+            "static char* word;\n"
+            "static size_t word_capacity;\n\n"
+            "static int compareTerminals(const void* key, const void* element){\n"
+            "    return strcmp((const char*)key, ((const struct terminal*)element)->name);\n"
+            "}\n\n");
+    }
+
+    fprintf(out,
+        "static int nextToken(void){\n"
+        "    int c = readChar();\n"
+        "    while (c != EOF && isBlank(c)){\n"
+        "        c = readChar();\n"
+        "    }\n"
+        "    if (c == EOF){\n"
+        "        return END_OF_INPUT;\n"
+        "    }\n"
+        "    tokens_read++;\n");
+    if (multiCharacter){
+        fprintf(out,
+            "\n"
+            "    size_t wordLength = 0;\n"
+            "    while (c != EOF && !isBlank(c)){\n"
+            "        if (wordLength + 1 >= word_capacity){\n"
+            "            word_capacity *= 2;\n"
+            "            word = realloc(word, word_capacity);\n"
+            "            if (word == NULL){\n"
+            "                fprintf(stderr, \"Memoria esaurita\\n\");\n"
+            "                exit(2);\n"
+            "            }\n"
+            "        }\n"
+            "        word[wordLength++] = c;\n"
+            "        c = readChar();\n"
+            "    }\n"
+            "    word[wordLength] = '\\0';\n\n"
+            "    const struct terminal* terminal = bsearch(word, terminals, %d, sizeof(struct terminal), compareTerminals);\n"
+            "    return terminal != NULL ? terminal->id : NO_SYMBOL;\n"
+            "}\n\n", terminals);
+    }else{
+        fprintf(out, "    return char_terminal[c];\n}\n\n");
+    }
+
+    fprintf(out,
+        "static void push(int state){\n"
+        "    if (depth == capacity){\n"
+        "        capacity *= 2;\n"
+        "        stack = realloc(stack, capacity * sizeof(int));\n"
+        "        if (stack == NULL){\n"
+        "            fprintf(stderr, \"Memoria esaurita\\n\");\n"
+        "            exit(2);\n"
+        "        }\n"
+        "    }\n"
+        "    stack[depth++] = state;\n"
+        "}\n\n");
+
+    // parser: uno switch per stato e uno per ogni non terminale ridotto
+    bool* reduced = calloc(nonTerminals, sizeof(bool));
+    int* productionLength = malloc(grammar->productions_count * sizeof(int));
+    int* productionDriver = malloc(grammar->productions_count * sizeof(int));
+    for (int t=0; t<grammar->productions_count; t++){
+        productionLength[grammar->productions[t].production_id] = grammar->productions[t].body_length;
+        productionDriver[grammar->productions[t].production_id] = nonTerminalIndex(grammar, grammar->productions[t].driver);
+    }
+
+    fprintf(out, "static int parse(void){\n    int token;\n\n    depth = 0;\n    token = nextToken();\n    goto state_0;\n");
+
+    for (int state=0; state<tables->states_count; state++){
+        int* row = &tables->action[state * terminals];
+        int defaultAction = tables->default_reduction[state];
+        bool* emitted = calloc(terminals, sizeof(bool));
+
+        fprintf(out, "\nstate_%d:\n    push(%d);\n    switch (token){\n", state, state);
+        for (int t=0; t<terminals; t++){
+            if (emitted[t] || row[t] == ACTION_ERROR || row[t] == defaultAction){
+                continue;
+            }
+
+            // tutti i terminali con la stessa azione condividono il caso
+            fprintf(out, "        ");
+            for (int k=t; k<terminals; k++){
+                if (row[k] == row[t]){
+                    fprintf(out, "case %d: ", k);
+                    emitted[k] = true;
+                }
+            }
+
+            switch (actionType(row[t])){
+                case ACTION_SHIFT:
+                    fprintf(out, "token = nextToken(); goto state_%d;\n", actionArgument(row[t]));
+                    break;
+                case ACTION_REDUCE:
+                    fprintf(out, "depth -= %d; goto goto_%d;\n", productionLength[actionArgument(row[t])], productionDriver[actionArgument(row[t])]);
+                    reduced[productionDriver[actionArgument(row[t])]] = true;
+                    break;
+                case ACTION_ACCEPT:
+                    fprintf(out, "return 1;\n");
+                    break;
+            }
+        }
+        if (defaultAction != ACTION_ERROR){
+            fprintf(out, "        default: depth -= %d; goto goto_%d;\n", productionLength[actionArgument(defaultAction)], productionDriver[actionArgument(defaultAction)]);
+            reduced[productionDriver[actionArgument(defaultAction)]] = true;
+        }else{
+            fprintf(out, "        default: return 0;\n");
+        }
+        fprintf(out, "    }\n");
+        free(emitted);
+    }
+
+    for (int n=0; n<nonTerminals; n++){
+        if (!reduced[n]){
+            continue;
+        }
+        fprintf(out, "\ngoto_%d:\n    switch (stack[depth - 1]){\n", n);
+        for (int state=0; state<tables->states_count; state++){
+            int destination = tables->goto_table[state * nonTerminals + n];
+            if (destination != EMPTY_ENTRY){
+                fprintf(out, "        case %d: goto state_%d;\n", state, destination);
+            }
+        }
+        fprintf(out, "    }\n    return 0;\n");
+    }
+    fprintf(out, "}\n\n");
+
+    free(reduced);
+    free(productionLength);
+    free(productionDriver);
+
+    fprintf(out,
+        "int main(int argc, char** argv){\n"
+        "    const char* path = NULL;\n"
+        "    int timing = 0;\n"
+        "    for (int i=1; i<argc; i++){\n"
+        "        if (strcmp(argv[i], \"-t\") == 0){\n"
+        "            timing = 1;\n"
+        "        }else{\n"
+        "            path = argv[i];\n"
+        "        }\n"
+        "    }\n\n"
+        "    source = path != NULL ? fopen(path, \"r\") : stdin;\n"
+        "    if (source == NULL){\n"
+        "        printf(\"Impossibile aprire il file %%s\\n\", path);\n"
+        "        return 2;\n"
+        "    }\n"
+        "    capacity = 256;\n"
+        "    stack = malloc(capacity * sizeof(int));\n");
+    if (multiCharacter){
+        fprintf(out,
+            "    word_capacity = 64;\n"
+            "    word = malloc(word_capacity);\n");
+    }
+    fprintf(out,
+        "\n"
+        "    struct timespec start, end;\n"
+        "    clock_gettime(CLOCK_MONOTONIC, &start);\n"
+        "    int accepted = parse();\n"
+        "    clock_gettime(CLOCK_MONOTONIC, &end);\n\n"
+        "    if (accepted){\n"
+        "        printf(\"Input accettato (%%ld token)\\n\", tokens_read);\n"
+        "    }else{\n"
+        "        printf(\"Errore di sintassi al token %%ld\\n\", tokens_read);\n"
+        "    }\n"
+        "    if (timing){\n"
+        "        printf(\"Tempo: %%.9f s\\n\", (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);\n"
+        "    }\n"
+        "    return accepted ? 0 : 1;\n"
+        "}\n");
+}
+
+/**
+* Benchmark della ricerca dei kernel: confronta la scansione lineare originale con la tabella hash
+* su una famiglia di grammatiche S -> aa..a | bb..b | ... con un numero di stati crescente.
+*/
+int benchKernelLookup(){
+    const int alternatives = 8;
+    const int repetitions = 200;
+
+    printf("%8s %16s %16s %10s %14s\n", "stati", "lineare (us)", "hash (us)", "speedup", "memoria (KB)");
+    for (int bodyLength=4; bodyLength <= 48; bodyLength+=4){
+        struct arena grammarArena = {0};
+        struct grammar grammar;
+        initGrammar(&grammar, &grammarArena, false);
+
+        char production[64];
+        addFreshProduction(&grammar, "S");
+        for (int a=0; a<alternatives; a++){
+            sprintf(production, "S->");
+            memset(production + 3, 'a' + a, bodyLength);
+            production[3 + bodyLength] = '\0';
+            addProduction(&grammar, production);
+        }
+        updateFreshSymbol(&grammar);
+        finalizeGrammar(&grammar);
+
+        double elapsed[2];
+        int totalStates = 0;
+        size_t peakBytes = 0;
+
+        for (int mode=0; mode<2; mode++){
+            linearKernelLookup = (mode == 0);
+            double start = currentTimeSeconds();
+            for (int r=0; r<repetitions; r++){
+                struct arena arena = {0};
+                struct automa automa;
+                initAutoma(&automa, &arena);
+                totalStates = generateAutomaChar(&automa, &grammar);
+                peakBytes = arenaPeakBytes(&arena);
+                arenaFree(&arena);
+            }
+            elapsed[mode] = (currentTimeSeconds() - start) / repetitions * 1e6;
+        }
+
+        printf("%8d %16.2f %16.2f %9.2fx %14.1f\n", totalStates, elapsed[0], elapsed[1], elapsed[0] / elapsed[1], peakBytes / 1024.0);
+        arenaFree(&grammarArena);
+    }
+
+    linearKernelLookup = false;
+    return 0;
+}
+
+
+// grammatiche di test utilizzate dai benchmark dei parser, con il relativo start symbol
+#define TEST_GRAMMARS_COUNT 7
+const char* testGrammarFiles[TEST_GRAMMARS_COUNT] = { "grammar1.txt", "grammar2.txt", "grammar3.txt", "grammar4.txt", "grammar5.txt", "grammar6.txt", "grammar7.txt" };
+const char* testGrammarStartSymbols[TEST_GRAMMARS_COUNT] = { "S", "E", "E", "S", "S", "S", "S" };
+
+/**
+* Legge e normalizza la grammatica di test "index" dalla cartella test-grammars
+*
+* Ritorna: false se il file non puo' essere aperto
+*/
+bool loadTestGrammar(struct grammar* grammar, struct arena* arena, int index){
+    char path[256];
+    snprintf(path, sizeof(path), "test-grammars/%s", testGrammarFiles[index]);
+    FILE* source = fopen(path, "r");
+    if (source == NULL){
+        fprintf(stderr, "Impossibile aprire %s: eseguire il benchmark dalla radice del repository\n", path);
+        return false;
+    }
+
+    initGrammar(grammar, arena, false);
+    addFreshProduction(grammar, testGrammarStartSymbols[index]);
+    readGrammar(grammar, source, false);
+    fclose(source);
+    updateFreshSymbol(grammar);
+    finalizeGrammar(grammar);
+    return true;
+}
+
+/**
+* Per ogni non terminale calcola la produzione che deriva la stringa di terminali piu' corta (punto fisso sulle
+* lunghezze minime); -1 se il non terminale non deriva nessuna stringa di terminali
+*/
+int* computeShortestProductions(struct grammar* grammar, struct arena* arena){
+    int nonTerminals = nonTerminalsCount(grammar);
+    int* shortest = arenaAlloc(arena, nonTerminals * sizeof(int));
+    int* minLength = arenaAlloc(arena, nonTerminals * sizeof(int));
+    for (int n=0; n<nonTerminals; n++){
+        shortest[n] = -1;
+        minLength[n] = -1;
+    }
+
+    bool changed = true;
+    while (changed){
+        changed = false;
+        for (int t=0; t<grammar->productions_count; t++){
+            struct production* production = &grammar->productions[t];
+            int length = 0;
+            for (int i=0; i<production->body_length && length != -1; i++){
+                int symbol = production->body[i];
+                int symbolLength = isNonTerminal(grammar, symbol) ? minLength[nonTerminalIndex(grammar, symbol)] : 1;
+                length = symbolLength == -1 ? -1 : length + symbolLength;
+            }
+
+            int driver = nonTerminalIndex(grammar, production->driver);
+            if (length != -1 && (minLength[driver] == -1 || length < minLength[driver])){
+                minLength[driver] = length;
+                shortest[driver] = t;
+                changed = true;
+            }
+        }
+    }
+
+    return shortest;
+}
+
+static inline uint32_t nextRandom(uint32_t* state){
+    // xorshift32
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+* Scrive su out una frase casuale del linguaggio con circa targetTokens token: finche' la frase e' piu' corta di
+* targetTokens i non terminali vengono espansi con una produzione casuale diversa dalla piu' corta (se esiste),
+* poi con le produzioni piu' corte.
+*
+* Ritorna: il numero di token scritti, -1 se la grammatica contiene non terminali improduttivi raggiungibili
+*/
+long writeRandomSentence(struct grammar* grammar, int* shortest, FILE* out, long targetTokens, uint32_t* seed, struct arena* arena){
+    bool multiCharacter = grammar->symbols.multi_character;
+    int capacity = 256;
+    int* pending = arenaAlloc(arena, capacity * sizeof(int)); // simboli ancora da espandere, in cima il piu' a sinistra
+    int depth = 0;
+    long written = 0;
+
+    pending[depth++] = grammar->productions[0].driver;
+    while (depth > 0){
+        int symbol = pending[--depth];
+
+        if (!isNonTerminal(grammar, symbol)){
+            fputs(symbolName(grammar, symbol), out);
+            written++;
+            if (multiCharacter){
+                fputc(written % 16 == 0 ? '\n' : ' ', out);
+            }else if (written % 64 == 0){
+                fputc('\n', out);
+            }
+            continue;
+        }
+
+        int n = nonTerminalIndex(grammar, symbol);
+        int production = shortest[n];
+        if (production == -1){
+            return -1;
+        }
+        if (written + depth < targetTokens){
+            int first = grammar->nonterminal_first_production[n];
+            int count = grammar->nonterminal_first_production[n + 1] - first;
+            int offset = nextRandom(seed) % count;
+            if (count > 1 && grammar->nonterminal_productions[first + offset] == production){
+                offset = (offset + 1 + nextRandom(seed) % (count - 1)) % count;
+            }
+            production = grammar->nonterminal_productions[first + offset];
+        }
+
+        struct production* chosen = &grammar->productions[production];
+        ensureCapacity(arena, (void**)&pending, &capacity, depth + chosen->body_length, sizeof(int));
+        for (int i=chosen->body_length - 1; i>=0; i--){
+            pending[depth++] = chosen->body[i];
+        }
+    }
+
+    return written;
+}
+
+/**
+* Benchmark del parser guidato dalle tabelle SLR compresse: per ogni grammatica di test genera frasi casuali
+* del linguaggio, le scrive su un file temporaneo e misura il parsing in streaming dal file.
+*/
+int benchParser(){
+    const long sizes[] = { 100, 100000 };
+    const int inputs = 20;
+
+    printf("%-14s %6s %10s %6s %14s %16s %16s %10s\n", "grammatica", "stati", "token", "input", "token/s", "latenza (us)", "latenza max (us)", "accettati");
+    for (int g=0; g<TEST_GRAMMARS_COUNT; g++){
+        struct arena arena = {0};
+        struct grammar grammar;
+        struct automa automa;
+        struct parse_tables tables;
+        struct lr_parser parser;
+        struct token_reader* reader = arenaAlloc(&arena, sizeof(struct token_reader));
+
+        if (!loadTestGrammar(&grammar, &arena, g)){
+            arenaFree(&arena);
+            return 1;
+        }
+        initAutoma(&automa, &arena);
+
+        int totalStates = generateAutomaChar(&automa, &grammar);
+        buildParseTables(&tables, &automa, slr_tables, &arena);
+        initParser(&parser, &tables, &grammar, &arena);
+        initTokenReader(reader, &grammar, &arena);
+        int* shortest = computeShortestProductions(&grammar, &arena);
+
+        for (int s=0; s<(int)(sizeof(sizes) / sizeof(sizes[0])); s++){
+            uint32_t seed = 0x9e3779b9u ^ (g * 131 + s);
+            long totalTokens = 0;
+            int accepted = 0;
+            double totalTime = 0, maxTime = 0;
+
+            for (int i=0; i<inputs; i++){
+                FILE* input = tmpfile();
+                if (input == NULL || writeRandomSentence(&grammar, shortest, input, sizes[s], &seed, &arena) < 0){
+                    fprintf(stderr, "Impossibile generare l'input per %s\n", testGrammarFiles[g]);
+                    return 1;
+                }
+                rewind(input);
+
+                double start = currentTimeSeconds();
+                setTokenSource(reader, input);
+                accepted += parseInput(&parser, reader);
+                double elapsed = currentTimeSeconds() - start;
+
+                totalTokens += reader->tokens_read;
+                totalTime += elapsed;
+                if (elapsed > maxTime){
+                    maxTime = elapsed;
+                }
+                fclose(input);
+            }
+
+            printf("%-14s %6d %10ld %6d %14.0f %16.2f %16.2f %7d/%d\n", testGrammarFiles[g], totalStates, totalTokens / inputs, inputs,
+                totalTokens / totalTime, totalTime / inputs * 1e6, maxTime * 1e6, accepted, inputs);
+        }
+
+        arenaFree(&arena);
+    }
+
+    return 0;
+}
+
+
+/**
+* Benchmark del parser direct-coded: per ogni grammatica di test genera il sorgente C del parser, lo compila con
+* il compilatore indicato dalla variabile d'ambiente CC (cc se assente) e confronta il tempo di parsing dello
+* stesso input con quello del parser guidato dalle tabelle. Per entrambi si considera il migliore di 5 esecuzioni.
+*/
+int benchDirectParser(){
+    const long inputTokens = 1000000;
+    const int repetitions = 5;
+    const char* compiler = getenv("CC") != NULL ? getenv("CC") : "cc";
+
+    char directory[] = "/tmp/lr0-parser-XXXXXX";
+    if (mkdtemp(directory) == NULL){
+        fprintf(stderr, "Impossibile creare la cartella temporanea\n");
+        return 1;
+    }
+
+    printf("%-14s %6s %10s %16s %16s %10s %6s\n", "grammatica", "stati", "token", "tabelle (tok/s)", "diretto (tok/s)", "speedup", "esito");
+    int result = 0;
+
+    for (int g=0; g<TEST_GRAMMARS_COUNT && result == 0; g++){
+        struct arena arena = {0};
+        struct grammar grammar;
+        struct automa automa;
+        struct parse_tables tables;
+        struct lr_parser parser;
+        struct token_reader* reader = arenaAlloc(&arena, sizeof(struct token_reader));
+        char sourcePath[512], executablePath[512], inputPath[512], command[2048];
+
+        if (!loadTestGrammar(&grammar, &arena, g)){
+            arenaFree(&arena);
+            result = 1;
+            break;
+        }
+        initAutoma(&automa, &arena);
+        int totalStates = generateAutomaChar(&automa, &grammar);
+        buildParseTables(&tables, &automa, slr_tables, &arena);
+        initParser(&parser, &tables, &grammar, &arena);
+        initTokenReader(reader, &grammar, &arena);
+
+        snprintf(sourcePath, sizeof(sourcePath), "%s/parser%d.c", directory, g);
+        snprintf(executablePath, sizeof(executablePath), "%s/parser%d", directory, g);
+        snprintf(inputPath, sizeof(inputPath), "%s/input%d.txt", directory, g);
+
+        // sorgente e compilazione del parser direct-coded
+        FILE* out = fopen(sourcePath, "w");
+        FILE* input = fopen(inputPath, "w");
+        uint32_t seed = 0x9e3779b9u ^ g;
+        if (out == NULL || input == NULL){
+            fprintf(stderr, "Impossibile scrivere nella cartella %s\n", directory);
+            result = 1;
+        }else{
+            emitDirectParser(out, &tables, &grammar);
+            writeRandomSentence(&grammar, computeShortestProductions(&grammar, &arena), input, inputTokens, &seed, &arena);
+        }
+        if (out != NULL) fclose(out);
+        if (input != NULL) fclose(input);
+
+        snprintf(command, sizeof(command), "%s -O2 -o %s %s", compiler, executablePath, sourcePath);
+        if (result == 0 && system(command) != 0){
+            fprintf(stderr, "Compilazione fallita: %s\n", command);
+            result = 1;
+        }
+
+        double bestTables = -1, bestDirect = -1;
+        bool tablesAccepted = false, directAccepted = false;
+        long tokens = 0;
+
+        for (int r=0; r<repetitions && result == 0; r++){
+            FILE* parseSource = fopen(inputPath, "r");
+            double start = currentTimeSeconds();
+            setTokenSource(reader, parseSource);
+            tablesAccepted = parseInput(&parser, reader);
+            double elapsed = currentTimeSeconds() - start;
+            fclose(parseSource);
+            tokens = reader->tokens_read;
+            if (bestTables < 0 || elapsed < bestTables){
+                bestTables = elapsed;
+            }
+
+            snprintf(command, sizeof(command), "%s -t %s", executablePath, inputPath);
+            FILE* process = popen(command, "r");
+            char line[256];
+            double directElapsed = -1;
+            while (process != NULL && fgets(line, sizeof(line), process)){
+                if (strncmp(line, "Input accettato", 15) == 0){
+                    directAccepted = true;
+                }else if (strncmp(line, "Errore", 6) == 0){
+                    directAccepted = false;
+                }
+                sscanf(line, "Tempo: %lf", &directElapsed);
+            }
+            if (process != NULL){
+                pclose(process);
+            }
+            if (directElapsed < 0){
+                fprintf(stderr, "Esecuzione fallita: %s\n", command);
+                result = 1;
+            }else if (bestDirect < 0 || directElapsed < bestDirect){
+                bestDirect = directElapsed;
+            }
+        }
+
+        if (result == 0){
+            printf("%-14s %6d %10ld %16.0f %16.0f %9.2fx %6s\n", testGrammarFiles[g], totalStates, tokens, tokens / bestTables,
+                tokens / bestDirect, bestTables / bestDirect, tablesAccepted == directAccepted ? "uguale" : "DIVERSO");
+        }
+
+        remove(sourcePath);
+        remove(executablePath);
+        remove(inputPath);
+        arenaFree(&arena);
+    }
+
+    rmdir(directory);
+    return result;
+}
+
+
+/**
+* Controlla che due automi della stessa grammatica abbiano gli stessi stati e le stesse transizioni a meno della
+* numerazione: gli stati vengono messi in corrispondenza tramite il kernel
+*/
+bool sameAutomaUpToNumbering(struct automa* automa, struct automa* other){
+    if (automa->states_count != other->states_count){
+        return false;
+    }
+
+    int* match = arenaAlloc(automa->arena, automa->states_count * sizeof(int));
+    for (int id=0; id<automa->states_count; id++){
+        struct automa_state* state = &automa->states[id];
+        ensureKernelScratch(automa, state->kernel_items_count);
+        int kernelSize = canonicalKernelOfState(state, automa->scratch_kernel);
+        match[id] = findKernel(other, automa->scratch_kernel, kernelSize, hashKernel(automa->scratch_kernel, kernelSize));
+        if (match[id] == -1 || state->type != other->states[match[id]].type || state->items_count != other->states[match[id]].items_count ||
+            state->transition_count != other->states[match[id]].transition_count){
+            return false;
+        }
+    }
+    for (int id=0; id<automa->states_count; id++){
+        struct automa_state* otherState = &other->states[match[id]];
+        for (int tr=0; tr<automa->states[id].transition_count; tr++){
+            struct transition* transition = &automa->states[id].transitions[tr];
+            bool found = false;
+            for (int o=0; o<otherState->transition_count && !found; o++){
+                found = otherState->transitions[o].by == transition->by && otherState->transitions[o].destination == match[transition->destination];
+            }
+            if (!found){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+* Test dell'aggiornamento incrementale: per ogni grammatica di test e ogni sua produzione costruisce l'automa,
+* rimuove la produzione con applyGrammarDiff e updateAutomaIncremental e controlla che
+* - l'automa aggiornato sia uguale, a meno della numerazione, a quello costruito da zero;
+* - ogni stato preesistente rimasto nell'automa mantenga il suo numero, a meno che questo non superi il numero
+*   di stati dell'automa aggiornato.
+*
+* Ritorna: 0 se tutti i controlli sono superati
+*/
+int testIncremental(){
+    printf("%-14s %10s %10s %10s %10s %6s\n", "grammatica", "modifiche", "eliminati", "mantenuti", "rinumerati", "esito");
+    int result = 0;
+
+    for (int g=0; g<TEST_GRAMMARS_COUNT; g++){
+        int edits = 0, removed = 0, unchanged = 0, renumbered = 0;
+        bool passed = true;
+
+        for (int production=1; ; production++){
+            struct arena arena = {0};
+            struct grammar grammar;
+            struct automa automa, fresh;
+
+            if (!loadTestGrammar(&grammar, &arena, g)){
+                arenaFree(&arena);
+                return 1;
+            }
+            if (production >= grammar.productions_count){
+                arenaFree(&arena);
+                break;
+            }
+            initAutoma(&automa, &arena);
+            generateAutomaChar(&automa, &grammar);
+
+            // kernel canonici degli stati prima della modifica
+            int oldStatesCount = automa.states_count;
+            lr0_item** oldKernels = arenaAlloc(&arena, oldStatesCount * sizeof(lr0_item*));
+            int* oldKernelSizes = arenaAlloc(&arena, oldStatesCount * sizeof(int));
+            for (int id=0; id<oldStatesCount; id++){
+                ensureKernelScratch(&automa, automa.states[id].kernel_items_count);
+                oldKernelSizes[id] = canonicalKernelOfState(&automa.states[id], automa.scratch_kernel);
+                oldKernels[id] = arenaAlloc(&arena, oldKernelSizes[id] * sizeof(lr0_item));
+                memcpy(oldKernels[id], automa.scratch_kernel, oldKernelSizes[id] * sizeof(lr0_item));
+            }
+
+            FILE* edit = tmpfile();
+            if (edit == NULL){
+                fprintf(stderr, "Impossibile creare il file temporaneo delle modifiche\n");
+                arenaFree(&arena);
+                return 1;
+            }
+            fprintf(edit, "- %s -> ", symbolName(&grammar, grammar.productions[production].driver));
+            printBody(edit, &grammar, &grammar.productions[production], -1);
+            fprintf(edit, "\n");
+            rewind(edit);
+
+            struct grammar_diff diff;
+            struct incremental_report report;
+            applyGrammarDiff(&grammar, edit, stdout, &diff);
+            fclose(edit);
+            updateAutomaIncremental(&automa, &diff, &report);
+            edits++;
+            removed += report.removed_states;
+
+            // numero degli stati preesistenti il cui kernel (tradotto nei nuovi id delle produzioni) e' ancora presente
+            for (int id=0; id<oldStatesCount; id++){
+                bool survives = true;
+                for (int i=0; i<oldKernelSizes[id] && survives; i++){
+                    int newProduction = diff.production_map[itemProduction(oldKernels[id][i])];
+                    survives = newProduction != -1;
+                    oldKernels[id][i] = makeItem(newProduction, itemMarker(oldKernels[id][i]), false);
+                }
+                int newId = survives ? findKernel(&automa, oldKernels[id], oldKernelSizes[id], hashKernel(oldKernels[id], oldKernelSizes[id])) : -1;
+                if (newId == id){
+                    unchanged++;
+                }else if (newId != -1){
+                    renumbered++;
+                    passed &= id >= automa.states_count;
+                }
+            }
+            passed &= report.renumbered_states == 0 || renumbered > 0;
+
+            initAutoma(&fresh, &arena);
+            generateAutomaChar(&fresh, &grammar);
+            passed &= sameAutomaUpToNumbering(&automa, &fresh);
+            arenaFree(&arena);
+        }
+
+        printf("%-14s %10d %10d %10d %10d %6s\n", testGrammarFiles[g], edits, removed, unchanged, renumbered, passed ? "ok" : "ERRORE");
+        result |= !passed;
+    }
+    return result;
+}
+
+/////////////////////////////// GRAMMATICHE SINTETICHE //////////////////////////////
+
+const char* recursionShapeNames[] = { "none", "left", "right", "mixed" };
+
+void defaultSyntheticOptions(struct synthetic_options* options){
+    const int sizes[] = { 25, 50, 100, 200, 400, 800 };
+
+    memcpy(options->sizes, sizes, sizeof(sizes));
+    options->sizes_count = sizeof(sizes) / sizeof(sizes[0]);
+    options->productions = 4;
+    options->body_length = 4;
+    options->terminals = 16;
+    options->epsilon_density = 0.1;
+    options->nonterminal_density = 0.3;
+    options->recursion = mixed_recursion;
+    options->seed = 1;
+    options->repetitions = 3;
+}
+
+static inline bool optionKeyIs(const char* option, int keyLength, const char* key){
+    return (int)strlen(key) == keyLength && strncmp(option, key, keyLength) == 0;
+}
+
+/**
+* Legge le opzioni del generatore nella forma chiave=valore; "nonterminals" accetta una lista separata da virgole
+*
+* Ritorna: false se un'opzione non e' valida
+*/
+bool parseSyntheticOptions(struct synthetic_options* options, int argc, char** argv){
+    for (int i=0; i<argc; i++){
+        char* value = strchr(argv[i], '=');
+        if (value == NULL){
+            fprintf(stderr, "Opzione non valida: %s (atteso chiave=valore)\n", argv[i]);
+            return false;
+        }
+        int keyLength = value - argv[i];
+        value++;
+
+        if (optionKeyIs(argv[i], keyLength, "nonterminals")){
+            options->sizes_count = 0;
+            for (char* size = strtok(value, ","); size != NULL && options->sizes_count < 32; size = strtok(NULL, ",")){
+                options->sizes[options->sizes_count++] = atoi(size);
+            }
+        }else if (optionKeyIs(argv[i], keyLength, "productions")){
+            options->productions = atoi(value);
+        }else if (optionKeyIs(argv[i], keyLength, "body")){
+            options->body_length = atoi(value);
+        }else if (optionKeyIs(argv[i], keyLength, "terminals")){
+            options->terminals = atoi(value);
+        }else if (optionKeyIs(argv[i], keyLength, "epsilon")){
+            options->epsilon_density = atof(value);
+        }else if (optionKeyIs(argv[i], keyLength, "density")){
+            options->nonterminal_density = atof(value);
+        }else if (optionKeyIs(argv[i], keyLength, "seed")){
+            options->seed = strtoul(value, NULL, 10);
+        }else if (optionKeyIs(argv[i], keyLength, "repetitions")){
+            options->repetitions = atoi(value);
+        }else if (optionKeyIs(argv[i], keyLength, "recursion")){
+            int shape = -1;
+            for (int r=0; r<4; r++){
+                if (strcmp(value, recursionShapeNames[r]) == 0){
+                    shape = r;
+                }
+            }
+            if (shape == -1){
+                fprintf(stderr, "Forma della ricorsione non valida: %s (none, left, right, mixed)\n", value);
+                return false;
+            }
+            options->recursion = shape;
+        }else{
+            fprintf(stderr, "Opzione sconosciuta: %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    if (options->sizes_count == 0 || options->productions < 1 || options->body_length < 1 || options->terminals < 1 || options->repetitions < 1){
+        fprintf(stderr, "I parametri numerici devono essere positivi\n");
+        return false;
+    }
+    for (int i=0; i<options->sizes_count; i++){
+        if (options->sizes[i] < 1){
+            fprintf(stderr, "I parametri numerici devono essere positivi\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+* Genera una grammatica sintetica con simboli a piu' caratteri: non terminali N0..N(n-1), terminali t0..t(T-1),
+* start symbol N0. La prima produzione di ogni non terminale e' ricorsiva secondo la forma scelta (nel caso mixed
+* alternativamente sinistra e destra); negli altri body un non terminale Ni fa riferimento solo a non terminali Nk
+* con k > i, e l'ultima produzione contiene N(i+1), quindi tutti i non terminali sono raggiungibili e produttivi.
+*/
+void generateSyntheticGrammar(struct grammar* grammar, struct arena* arena, struct synthetic_options* options, int nonTerminals){
+    uint32_t seed = options->seed * 2654435761u + nonTerminals;
+    char name[32];
+    int* nonTerminalIds = arenaAlloc(arena, nonTerminals * sizeof(int));
+    int* terminalIds = arenaAlloc(arena, options->terminals * sizeof(int));
+    int* body = arenaAlloc(arena, (options->body_length + 2) * sizeof(int));
+
+    if (seed == 0){ // xorshift non esce dallo stato 0
+        seed = 1;
+    }
+
+    initGrammar(grammar, arena, true);
+    addFreshProduction(grammar, "N0");
+    for (int n=0; n<nonTerminals; n++){
+        int length = sprintf(name, "N%d", n);
+        nonTerminalIds[n] = internSymbol(grammar, name, length);
+    }
+    for (int t=0; t<options->terminals; t++){
+        int length = sprintf(name, "t%d", t);
+        terminalIds[t] = internSymbol(grammar, name, length);
+    }
+
+    for (int n=0; n<nonTerminals; n++){
+        for (int p=0; p<options->productions; p++){
+            bool recursive = p == 0 && options->recursion != no_recursion && options->productions > 1;
+            bool linkNext = p == options->productions - 1 && n + 1 < nonTerminals;
+            int bodyLength = 0;
+
+            if (!recursive && !linkNext && (nextRandom(&seed) % 1000) < options->epsilon_density * 1000){
+                appendProduction(grammar, nonTerminalIds[n], body, 0);
+                continue;
+            }
+
+            int length = 1 + nextRandom(&seed) % options->body_length;
+            for (int i=0; i<length; i++){
+                if (n + 1 < nonTerminals && (nextRandom(&seed) % 1000) < options->nonterminal_density * 1000){
+                    body[bodyLength++] = nonTerminalIds[n + 1 + nextRandom(&seed) % (nonTerminals - n - 1)];
+                }else{
+                    body[bodyLength++] = terminalIds[nextRandom(&seed) % options->terminals];
+                }
+            }
+
+            if (linkNext){
+                body[nextRandom(&seed) % bodyLength] = nonTerminalIds[n + 1];
+            }
+            if (recursive){
+                bool left = options->recursion == left_recursion || (options->recursion == mixed_recursion && n % 2 == 0);
+                if (left){
+                    memmove(body + 1, body, bodyLength * sizeof(int));
+                    body[0] = nonTerminalIds[n];
+                    bodyLength++;
+                }else{
+                    body[bodyLength++] = nonTerminalIds[n];
+                }
+            }
+
+            appendProduction(grammar, nonTerminalIds[n], body, bodyLength);
+        }
     }
-    return false;
-}
 
+    updateFreshSymbol(grammar);
+    finalizeGrammar(grammar);
+}
 
 /**
-* Rimuove gli spazi da una stringa, in questo caso da una produzione
+* Scrive su stdout le grammatiche sintetiche richieste nel formato di input (da usare con --multichar N0),
+* separate da una riga vuota
 */
-void removeSpaces(char* production){
-    int resultLen = 0;
+int writeSyntheticGrammars(int argc, char** argv){
+    struct synthetic_options options;
+    defaultSyntheticOptions(&options);
+    if (!parseSyntheticOptions(&options, argc, argv)){
+        return 1;
+    }
 
-    for (int i=0; i<strlen(production); i++){
-        if (production[i] != ' '){
-            production[resultLen++] = production[i];
+    for (int s=0; s<options.sizes_count; s++){
+        struct arena arena = {0};
+        struct grammar grammar;
+        generateSyntheticGrammar(&grammar, &arena, &options, options.sizes[s]);
+
+        if (s > 0){
+            printf("\n");
+        }
+        for (int t=1; t<grammar.productions_count; t++){ // la fresh production viene aggiunta alla lettura
+            printf("%s ->", symbolName(&grammar, grammar.productions[t].driver));
+            if (grammar.productions[t].body_length == 0){
+                printf(" %s", EPSILON);
+            }
+            for (int i=0; i<grammar.productions[t].body_length; i++){
+                printf(" %s", symbolName(&grammar, grammar.productions[t].body[i]));
+            }
+            printf("\n");
         }
+        arenaFree(&arena);
     }
-    production[resultLen] = '\0';
-
+    return 0;
 }
 
-/*
-* Funzione di supporto utilizzata per aggiungere una produzione alla grammatica data
-* 
-* Parametri:
-*  - grammar : la grammatica in cui inserire la nuova produzione
-*  - production : la produzione da inserire
-*  - productions_count : il numero di produzioni aggiunte fin'ora
-* 
-* Ritorna:
-*  - true : produzione inserita con successo
-*  - false : errore, la produzione non e'stata inserita in quanto non rispetta lo standard A -> beta
+/**
+* Benchmark di scalabilita': per ogni dimensione della serie genera la grammatica sintetica e ne costruisce l'automa
+* "repetitions" volte. Per ogni grammatica scrive su stdout una riga JSON con i parametri, il numero di produzioni,
+* stati, item e transizioni, il tempo minimo di costruzione e il picco di memoria dell'automa.
 */
-bool addProduction(struct production* grammar, char* new_production, int* productions_count){
-    // split della produzione in driver e body
-    int bodyStartPosition;
-    bool foundArrow = false;
-    
-    // rimozione degli spazi
-    removeSpaces(new_production);
+int benchScaling(int argc, char** argv){
+    struct synthetic_options options;
+    defaultSyntheticOptions(&options);
+    if (!parseSyntheticOptions(&options, argc, argv)){
+        return 1;
+    }
 
-    // ricerca di produzioni multi-defined (separate dalla | )
-    char newSeparatedProduction[PRODUCTION_LENGTH] = "_ ->";
-    char* separatorOccurence = strchr(new_production, '|');
+    for (int s=0; s<options.sizes_count; s++){
+        struct arena grammarArena = {0};
+        struct grammar grammar;
+        generateSyntheticGrammar(&grammar, &grammarArena, &options, options.sizes[s]);
 
-    if(separatorOccurence){
-        separatorOccurence[0] = '\0'; // sostituisci la | con il carattere di fine stringa nella produzione originale
-        newSeparatedProduction[0] = new_production[0]; // copia del driver
+        double best = -1;
+        size_t peakBytes = 0;
+        long items = 0, transitions = 0;
+        int states = 0;
 
-        strcat(newSeparatedProduction, separatorOccurence + 1); // aggiunta del body
+        for (int r=0; r<options.repetitions; r++){
+            struct arena arena = {0};
+            struct automa automa;
 
-        addProduction(grammar, newSeparatedProduction, productions_count);
-    }
+            double start = currentTimeSeconds();
+            initAutoma(&automa, &arena);
+            states = generateAutomaChar(&automa, &grammar);
+            double elapsed = currentTimeSeconds() - start;
 
-    // ricerca del sibolo arrow "->""
-    for (bodyStartPosition=1; bodyStartPosition<strlen(new_production); bodyStartPosition++){
-        if (new_production[bodyStartPosition-1] == '-' && new_production[bodyStartPosition] == '>' ){
-            bodyStartPosition++;
-            foundArrow = true;
-            break;
+            if (best < 0 || elapsed < best){
+                best = elapsed;
+            }
+            peakBytes = arenaPeakBytes(&arena);
+            items = 0;
+            transitions = 0;
+            for (int state=0; state<states; state++){
+                items += automa.states[state].items_count;
+                transitions += automa.states[state].transition_count;
+            }
+            arenaFree(&arena);
         }
-    }
-
-    // se e' una produzione valida
-    if (foundArrow && isNonTerminal(new_production[0])){
-        
-        // Aggiungi la produzione alla grammatica separando driver e body
-        grammar[*productions_count].driver = new_production[0];
-        strcpy(grammar[*productions_count].body, (new_production + bodyStartPosition));
-        grammar[*productions_count].production_id = *productions_count; 
-        
-        (*productions_count)++;
 
-        return true;
+        printf("{\"nonterminals\": %d, \"productions_per_nonterminal\": %d, \"body_length\": %d, \"terminals\": %d, "
+            "\"recursion\": \"%s\", \"epsilon_density\": %.3f, \"nonterminal_density\": %.3f, \"seed\": %u, \"threads\": %d, "
+            "\"productions\": %d, \"states\": %d, \"items\": %ld, \"transitions\": %ld, \"wall_seconds\": %.6f, \"peak_bytes\": %zu}\n",
+            options.sizes[s], options.productions, options.body_length, options.terminals,
+            recursionShapeNames[options.recursion], options.epsilon_density, options.nonterminal_density, options.seed, constructionThreads,
+            grammar.productions_count, states, items, transitions, best, peakBytes);
+        fflush(stdout);
+        arenaFree(&grammarArena);
     }
-
-    return false;
+    return 0;
 }
 
 /**
-* cambia il fresh symbol della grammatica nel caso in cui vi fosse un conflitto 
+* Confronta sulle grammatiche sintetiche il calcolo di nullable, FIRST e FOLLOW con le code di lavoro e con il
+* punto fisso sulle produzioni (miglior tempo su "repetitions" esecuzioni) e verifica che gli insiemi coincidano.
+* Una riga JSON per dimensione.
 */
-void updateFreshSymbol(struct production* grammar, int productions_count){
-    bool foundConflict = false;
-    char newFreshSymbol = 0;
-    char* freshSymbols = "KABCDEFGHIJLMNOPQRSTUVWXYZ"; // possibili fresh symbols
+int benchGrammarSets(int argc, char** argv){
+    struct synthetic_options options;
+    defaultSyntheticOptions(&options);
+    if (!parseSyntheticOptions(&options, argc, argv)){
+        return 1;
+    }
 
-    do {
-        foundConflict = false;
+    for (int s=0; s<options.sizes_count; s++){
+        struct arena grammarArena = {0};
+        struct arena arena = {0};
+        struct grammar grammar;
+        generateSyntheticGrammar(&grammar, &grammarArena, &options, options.sizes[s]);
+        int nonTerminals = nonTerminalsCount(&grammar);
 
-        for(int i=1; i<productions_count; i++){ //da 1 in quanto si evita di controllare la fresh production (la prima inserita nella grammatica)
-            if (grammar[i].driver == freshSymbols[newFreshSymbol]){ // fresh symbol che non va bene, ne cerco un altro
-                foundConflict = true;
-                newFreshSymbol++;
-                break;
+        struct grammar_sets sets[2];
+        double best[2] = { -1, -1 };
+        for (int mode=0; mode<2; mode++){
+            for (int r=0; r<options.repetitions; r++){
+                struct arena setsArena = {0};
+                double start = currentTimeSeconds();
+                if (mode == 0){
+                    computeGrammarSets(&grammar, &sets[mode], &setsArena);
+                }else{
+                    computeGrammarSetsNaive(&grammar, &sets[mode], &setsArena);
+                }
+                double elapsed = currentTimeSeconds() - start;
+                if (best[mode] < 0 || elapsed < best[mode]){
+                    best[mode] = elapsed;
+                }
+
+                // l'ultima esecuzione viene conservata per il confronto
+                if (r + 1 == options.repetitions){
+                    size_t setBytes = (size_t)nonTerminals * sets[mode].words * sizeof(uint64_t);
+                    struct grammar_sets copy = sets[mode];
+                    copy.nullable = arenaAlloc(&arena, nonTerminals * sizeof(bool) + 1);
+                    copy.first = arenaAlloc(&arena, setBytes + sizeof(uint64_t));
+                    copy.follow = arenaAlloc(&arena, setBytes + sizeof(uint64_t));
+                    memcpy(copy.nullable, sets[mode].nullable, nonTerminals * sizeof(bool));
+                    memcpy(copy.first, sets[mode].first, setBytes);
+                    memcpy(copy.follow, sets[mode].follow, setBytes);
+                    sets[mode] = copy;
+                }
+                arenaFree(&setsArena);
             }
         }
 
-    }while(foundConflict);
+        size_t setBytes = (size_t)nonTerminals * sets[0].words * sizeof(uint64_t);
+        bool identical = memcmp(sets[0].nullable, sets[1].nullable, nonTerminals * sizeof(bool)) == 0 &&
+            memcmp(sets[0].first, sets[1].first, setBytes) == 0 && memcmp(sets[0].follow, sets[1].follow, setBytes) == 0;
+        int nullableCount = 0;
+        for (int n=0; n<nonTerminals; n++){
+            nullableCount += sets[0].nullable[n];
+        }
 
-    // aggiorna il driver dell'entry point con il fresh symbol
-    grammar[0].driver = freshSymbols[newFreshSymbol];
-    printf("Il nuovo fresh Symbol e': %c\n", grammar[0].driver);
-    
+        printf("{\"nonterminals\": %d, \"productions\": %d, \"terminals\": %d, \"recursion\": \"%s\", \"epsilon_density\": %.3f, "
+            "\"seed\": %u, \"nullable\": %d, \"worklist_seconds\": %.6f, \"naive_seconds\": %.6f, \"identical\": %s}\n",
+            options.sizes[s], grammar.productions_count, grammar.symbols.terminals_count, recursionShapeNames[options.recursion],
+            options.epsilon_density, options.seed, nullableCount, best[0], best[1], identical ? "true" : "false");
+        fflush(stdout);
+        arenaFree(&arena);
+        arenaFree(&grammarArena);
+    }
+    return 0;
 }
 
 /**
-* destination e' lo stato di destinazione delle closure da aggiungere
+* Confronta sulle grammatiche sintetiche il calcolo dei lookahead LALR(1) con digraph e con la propagazione
+* ingenua (miglior tempo su "repetitions" esecuzioni), verifica che i lookahead coincidano e riporta i conflitti
+* delle tabelle SLR e LALR(1). Una riga JSON per dimensione.
 */
-void addItemToClosure(struct automa_state* destinationState, struct lr0_item* item){
-    int itemsInDestination = destinationState->items_count;
+int benchLalr(int argc, char** argv){
+    struct synthetic_options options;
+    defaultSyntheticOptions(&options);
+    if (!parseSyntheticOptions(&options, argc, argv)){
+        return 1;
+    }
 
-    // controllo che l'item non sia gia presente nella closure. Un elemento e gia presente nella closure se ha lo stesso identificativo (stesso driver e stesso body)
-    // e se la posizione del marker del nuovo item da inserire e' pari a 0
-    bool alreadyIn = false;
-    for (int i=0; i<itemsInDestination; i++){
-        if (destinationState->items[i].prod.production_id == item->prod.production_id && destinationState->items[i].marker_position == 0 ){
-            alreadyIn = true;
-            break;
+    for (int s=0; s<options.sizes_count; s++){
+        struct arena grammarArena = {0};
+        struct arena arena = {0};
+        struct grammar grammar;
+        struct automa automa;
+        generateSyntheticGrammar(&grammar, &grammarArena, &options, options.sizes[s]);
+        initAutoma(&automa, &arena);
+        int states = generateAutomaChar(&automa, &grammar);
+
+        struct lalr_lookaheads lookaheads[2];
+        double best[2] = { -1, -1 };
+        size_t bytes = 0;
+        for (int mode=0; mode<2; mode++){
+            for (int r=0; r<options.repetitions; r++){
+                struct arena lookaheadArena = {0};
+                double start = currentTimeSeconds();
+                computeLalrLookaheads(&lookaheads[mode], &automa, mode == 1, &lookaheadArena);
+                double elapsed = currentTimeSeconds() - start;
+                if (best[mode] < 0 || elapsed < best[mode]){
+                    best[mode] = elapsed;
+                }
+                bytes = arenaPeakBytes(&lookaheadArena);
+
+                // l'ultima esecuzione viene conservata per il confronto
+                if (r + 1 == options.repetitions){
+                    size_t setBytes = (size_t)lookaheads[mode].reductions_count * lookaheads[mode].words * sizeof(uint64_t);
+                    uint64_t* sets = arenaAlloc(&arena, setBytes + sizeof(uint64_t));
+                    memcpy(sets, lookaheads[mode].sets, setBytes);
+                    lookaheads[mode].sets = sets;
+                }
+                arenaFree(&lookaheadArena);
+            }
         }
-    }
+        bool identical = memcmp(lookaheads[0].sets, lookaheads[1].sets, (size_t)lookaheads[0].reductions_count * lookaheads[0].words * sizeof(uint64_t)) == 0;
 
-    if (alreadyIn == false){ // aggiungo solo se non e' gia presente
-        destinationState->items[itemsInDestination] = *item;
-        destinationState->items[itemsInDestination].marker_position = 0;
-        destinationState->items[itemsInDestination].isKernelProduction = false;
+        struct parse_tables slr, lalr;
+        buildParseTables(&slr, &automa, slr_tables, &arena);
+        buildParseTables(&lalr, &automa, lalr_tables, &arena);
 
-        destinationState->items_count++;
+        printf("{\"nonterminals\": %d, \"productions\": %d, \"recursion\": \"%s\", \"epsilon_density\": %.3f, \"seed\": %u, "
+            "\"states\": %d, \"nonterminal_transitions\": %d, \"reads_edges\": %d, \"includes_edges\": %d, \"reductions\": %d, "
+            "\"digraph_seconds\": %.6f, \"naive_seconds\": %.6f, \"peak_bytes\": %zu, \"identical\": %s, "
+            "\"slr_conflicts\": %d, \"lalr_conflicts\": %d}\n",
+            options.sizes[s], grammar.productions_count, recursionShapeNames[options.recursion], options.epsilon_density, options.seed,
+            states, lookaheads[0].nonterminal_transitions, lookaheads[0].reads_edges, lookaheads[0].includes_edges, lookaheads[0].reductions_count,
+            best[0], best[1], bytes, identical ? "true" : "false", slr.conflicts, lalr.conflicts);
+        fflush(stdout);
+        arenaFree(&arena);
+        arenaFree(&grammarArena);
     }
-    
+    return 0;
 }
 
-// funzione utilizzata per aggiungere una produzione al kernel di uno stato (inizializza il kernel a partire dallo stato precedente item)
-void addItemToKernel(struct automa_state* destinationState, struct lr0_item* item){
-    int itemsInDestination = destinationState->items_count;
+/////////////////////////////// SCRITTURA DELL'AUTOMA //////////////////////////////
 
-    // controllo che l'item non sia gia presente nella closure. Un elemento e gia presente nella closure se ha lo stesso identificativo (stesso driver e stesso body)
-    // e se la posizione del marker e' la stessa + 1 (la produzione aggiunta avra il marker spostato in avanti di una posizione)
-    bool alreadyIn = false;
-    for (int i=0; i<itemsInDestination; i++){
-        if (destinationState->items[i].prod.production_id == item->prod.production_id && destinationState->items[i].marker_position == item->marker_position + 1 ){
-            alreadyIn = true;
-            break;
+/**
+* Scrive text come stringa JSON
+*/
+void printJsonString(FILE* out, const char* text){
+    fputc('"', out);
+    for (const unsigned char* c=(const unsigned char*)text; *c != '\0'; c++){
+        if (*c == '"' || *c == '\\'){
+            fprintf(out, "\\%c", *c);
+        }else if (*c < 32){
+            fprintf(out, "\\u%04x", *c);
+        }else{
+            fputc(*c, out);
         }
     }
+    fputc('"', out);
+}
 
-    if (alreadyIn == false){ // aggiungo solo se non e' gia presente
-        destinationState->items[itemsInDestination] = *item;
-        destinationState->items[itemsInDestination].marker_position = item->marker_position + 1;
-        destinationState->items[itemsInDestination].isKernelProduction = true;
-
-        destinationState->items_count++;
-        destinationState->kernel_items_count++;
+/**
+* Scrive text all'interno di una etichetta DOT tra doppi apici
+*/
+void printDotText(FILE* out, const char* text){
+    for (const char* c=text; *c != '\0'; c++){
+        if (*c == '"' || *c == '\\'){
+            fputc('\\', out);
+        }
+        fputc(*c, out);
     }
-    
 }
 
+/**
+* Output testuale: grammatica, transizioni e item di ogni stato
+*/
+void writeAutomaHuman(FILE* out, struct automa* automa){
+    struct grammar* grammar = automa->grammar;
 
-void computeClosure(struct automa_state* state, struct production* grammar, int productions_count){
-    int unmarkedItemId = 0;
-    while( unmarkedItemId < state->items_count ){
-        // se contine un marker prima di un non terminale si fa la closure
-        int dot = state->items[unmarkedItemId].marker_position;
-        char nextToDot = state->items[unmarkedItemId].prod.body[dot];
-        if (isNonTerminal(nextToDot)){
-            for(int t=0; t<productions_count; t++){
-                if (grammar[t].driver == nextToDot){
-                    struct lr0_item newItem = {
-                        .prod = grammar[t],
-                        .marker_position = 0,
-                        .isKernelProduction = false
-                    };
-                    addItemToClosure(state, &newItem);
-                }
-            }
+    fprintf(out, "Il nuovo fresh Symbol e': %s\n", symbolName(grammar, grammar->productions[0].driver));
+    printGrammar(out, grammar);
+    fputs("============== TRANSIZIONI ==============\n", out);
+    printTransitions(out, automa);
+    printStates(out, automa);
+}
+
+/**
+* Output JSON: tabella dei simboli, produzioni e stati. Simboli e produzioni sono riferiti con il loro id
+* (indice nel rispettivo array), gli item con produzione e posizione del marker.
+*/
+void writeAutomaJson(FILE* out, struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+    static const char* typeNames[] = { "normal", "accept", "final" };
+
+    fputs("{\n  \"start\": ", out);
+    printJsonString(out, symbolName(grammar, grammar->productions[0].driver));
+    fputs(",\n  \"symbols\": [", out);
+    for (int symbol=0; symbol<grammar->symbols.symbols_count; symbol++){
+        fputs(symbol > 0 ? ",\n    {\"name\": " : "\n    {\"name\": ", out);
+        printJsonString(out, symbolName(grammar, symbol));
+        fprintf(out, ", \"terminal\": %s}", isNonTerminal(grammar, symbol) ? "false" : "true");
+    }
+    fputs("\n  ],\n  \"productions\": [", out);
+    for (int i=0; i<grammar->productions_count; i++){
+        struct production* production = &grammar->productions[i];
+        fprintf(out, "%s\n    {\"driver\": %d, \"body\": [", i > 0 ? "," : "", production->driver);
+        for (int t=0; t<production->body_length; t++){
+            fprintf(out, t > 0 ? ", %d" : "%d", production->body[t]);
+        }
+        fputs("]}", out);
+    }
+    fputs("\n  ],\n  \"states\": [", out);
+    for (int id=0; id<automa->states_count; id++){
+        struct automa_state* state = &automa->states[id];
+        fprintf(out, "%s\n    {\"id\": %d, \"type\": \"%s\", \"items\": [", id > 0 ? "," : "", id, typeNames[state->type]);
+        for (int i=0; i<state->items_count; i++){
+            lr0_item item = state->items[i];
+            fprintf(out, "%s{\"production\": %d, \"marker\": %d, \"kernel\": %s}", i > 0 ? ", " : "",
+                itemProduction(item), itemMarker(item), itemIsKernel(item) ? "true" : "false");
         }
-        unmarkedItemId++;
+        fputs("], \"transitions\": [", out);
+        for (int tr=0; tr<state->transition_count; tr++){
+            fprintf(out, "%s{\"symbol\": %d, \"destination\": %d}", tr > 0 ? ", " : "",
+                state->transitions[tr].by, state->transitions[tr].destination);
+        }
+        fputs("]}", out);
     }
-    
+    fputs("\n  ]\n}\n", out);
 }
 
 /**
-* Questa funzione permette di controllare se il kernel generato da uno stato "state" proseguendo con una transizione 
-* tramite "nextChar" e' gia presente tra quelli presenti nell'automa caratteristico. 
-* Se lo stato e' gia presente si ritorna l'identificativo dello stato
-*
-* Parametri:
-* - automa : l'automa caratteristico finale
-* - totalStates : numero di stati dell'automa caratteristico costruito fin'ora
-* - stateId : l'id dello stato sorgente. Si controllera' se questo stato e' gia presente nell'automa
-* - nextChar : il prossimo carattere della transizione (terminale o non terminale)
-*
-* Ritorna:
-* - id_stato : se si e' trovato uno stato con id stato_id e con kernel uguale gia presente 
-* - -1 : se non esiste ancora uno stato con quel kernel
+* Output DOT (Graphviz): un nodo per stato con gli item nell'etichetta, un arco per transizione.
+* Lo stato di accept e gli stati finali hanno il bordo doppio.
 */
-int getKernelEqualTo(struct automa_state* automa, int totalStates, int stateId, char nextChar){
-    int kernelEqualTo = -1;
+void writeAutomaDot(FILE* out, struct automa* automa){
+    struct grammar* grammar = automa->grammar;
+    const char* separator = grammar->symbols.multi_character ? " " : "";
 
-    struct lr0_item kernelOfState[MAX_GRAMMAR_PRODUCTIONS_NUMBER];
-    int stateIdKernelSize = 0;  // la dimensione del nuovo kernel effettuando una transizione con nextChar a partire da stateId
+    fputs("digraph automa {\n    rankdir=LR;\n    node [shape=box, fontname=\"monospace\"];\n", out);
+    for (int id=0; id<automa->states_count; id++){
+        struct automa_state* state = &automa->states[id];
+        fprintf(out, "    s%d [label=\"STATO %d\\l", id, id);
+        for (int i=0; i<state->items_count; i++){
+            struct production* production = &grammar->productions[itemProduction(state->items[i])];
+            int marker = itemMarker(state->items[i]);
 
-    // estrai le produzione che faranno parte del kernel del nuovo stato partendo da stateId
-    for (int i=0; i<automa[stateId].items_count; i++){
-        int marker_pos = automa[stateId].items[i].marker_position;
-        char productionNextChar = automa[stateId].items[i].prod.body[marker_pos];
-        
-        if (productionNextChar == nextChar){
-            kernelOfState[stateIdKernelSize++] = automa[stateId].items[i];
+            printDotText(out, symbolName(grammar, production->driver));
+            fputs(" -> ", out);
+            for (int t=0; t<production->body_length; t++){
+                if (t == marker){
+                    fputs(t > 0 ? separator : "", out);
+                    fputc('.', out);
+                    fputs(separator, out);
+                }else if (t > 0){
+                    fputs(separator, out);
+                }
+                printDotText(out, symbolName(grammar, production->body[t]));
+            }
+            if (marker == production->body_length){
+                fputs(production->body_length > 0 ? separator : "", out);
+                fputc('.', out);
+            }
+            fputs(itemIsKernel(state->items[i]) ? "  [ K ]\\l" : "\\l", out);
+        }
+        fprintf(out, "\"%s];\n", state->type != normal ? ", peripheries=2" : "");
+    }
+    for (int id=0; id<automa->states_count; id++){
+        for (int tr=0; tr<automa->states[id].transition_count; tr++){
+            struct transition* transition = &automa->states[id].transitions[tr];
+            fprintf(out, "    s%d -> s%d [label=\"", transition->from, transition->destination);
+            printDotText(out, symbolName(grammar, transition->by));
+            fputs("\"];\n", out);
         }
     }
+    fputs("}\n", out);
+}
 
-    // cerca se il kernel del futuro nuovo stato e' gia presente nell'automa. Nel caso fosse gia presente ritorniamo subito l'id dello stato uguale
-    for (int t=0; t<totalStates; t++){
-        
-        if (stateIdKernelSize == automa[t].kernel_items_count){ // affinche' due kernel siano uguali devono avere come minimo lo stesso numero di produzioni
-            bool allEqual = true; 
-        
-            for (int kernelProd=0; kernelProd<stateIdKernelSize; kernelProd++){
-                bool corrispondenza = false;
-                for (int prod=0; prod<automa[t].items_count; prod++){
-                    if (automa[t].items[prod].prod.production_id == kernelOfState[kernelProd].prod.production_id && automa[t].items[prod].marker_position == kernelOfState[kernelProd].marker_position+1 && automa[t].items[prod].isKernelProduction){
-                        corrispondenza = true; // ho trovato una produzione dell'automa che matcha con quella del kernel  
-                    }
-                }
+/**
+* Scrive l'automa costruito nel formato "format" (opzione --format). La scrittura avviene solo a costruzione
+* terminata, quindi non si alterna al calcolo degli stati; il formato binario e' l'immagine della cache.
+*
+* Ritorna: false se la scrittura non e' riuscita
+*/
+bool writeAutoma(FILE* out, struct automa* automa, output_format format){
+    switch (format){
+        case human_output:
+            writeAutomaHuman(out, automa);
+            break;
+        case json_output:
+            writeAutomaJson(out, automa);
+            break;
+        case dot_output:
+            writeAutomaDot(out, automa);
+            break;
+        case binary_output:
+            if (!writeAutomaImage(out, automa, hashGrammar(automa->grammar))){
+                return false;
+            }
+            break;
+    }
+    return fflush(out) == 0 && !ferror(out);
+}
 
-                if (corrispondenza == false){  // nessuna corrispondenza per questa produzione del kernel, posso terminare, sicuramente e' uno stato nuovo
-                    allEqual = false;
-                    break;
-                }
+/////////////////////////////// MODALITA' BATCH //////////////////////////////
 
-            }
+/**
+* Copia nell'arena i primi length caratteri di text
+*/
+char* arenaStrndup(struct arena* arena, const char* text, size_t length){
+    char* copy = arenaAlloc(arena, length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
 
+/**
+* Ricava lo start symbol di un file di grammatica: il driver della prima produzione
+*
+* Ritorna: NULL se il file non puo' essere letto o la prima riga non vuota (e non di commento) non e' una produzione
+*/
+char* readStartSymbol(const char* path, bool multiCharacter, struct arena* arena){
+    FILE* source = fopen(path, "r");
+    if (source == NULL){
+        return NULL;
+    }
 
-            if (allEqual == true){ // trovato
-                kernelEqualTo = t;
-                break;
-            }
+    char* line = NULL;
+    size_t capacity = 0;
+    char* startSymbol = NULL;
+    while (startSymbol == NULL && getline(&line, &capacity, source) > 0){
+        char* arrow = strstr(line, "->");
+        char* begin = line;
+        while (*begin == ' ' || *begin == '\t'){
+            begin++;
+        }
+        if (*begin == '\n' || *begin == '\r' || *begin == '\0' || *begin == '#'){
+            continue;
+        }
+        if (arrow == NULL || arrow == begin){
+            break;
+        }
 
+        char* end = multiCharacter ? arrow : begin + 1;
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\t')){
+            end--;
         }
-        
+        startSymbol = arenaStrndup(arena, begin, end - begin);
     }
-    
-    return kernelEqualTo;
+    free(line);
+    fclose(source);
+    return startSymbol;
 }
 
+int compareStrings(const void* a, const void* b){
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
 
 /**
-* Generazione dell'automa caratteristico,
-* Ritorna: il numero di stati dell'automa caratteristico
+* Legge l'elenco delle grammatiche del batch. Se path e' una cartella ogni file (non nascosto) e' una grammatica
+* il cui start symbol e' il driver della prima produzione, in ordine alfabetico; altrimenti path e' un manifest
+* con una coppia "start_symbol file" per riga (righe vuote e commenti con '#' ignorati), dove i percorsi relativi
+* sono relativi alla cartella del manifest.
+*
+* Ritorna: il numero di grammatiche, -1 se path non puo' essere letto
 */
-int generateAutomaChar(struct automa_state* automa, struct production* grammar, int productions_count, char startSymbol){
-    int totalStates = 0; 
+int collectBatchEntries(const char* path, bool multiCharacter, struct batch_entry** entries, struct arena* arena){
+    int count = 0, capacity = 16;
+    *entries = arenaAlloc(arena, capacity * sizeof(struct batch_entry));
 
-    // le seguenti due variabili servono per tenere traccia del numero di nuovi stati aggiunti a partire da ogni stato :
-    // in particolare serviranno per evitare di creare un nuovo stato se esistesse gia
-    char alreadyAddedNextChar[MAX_AUTOMA_STATES_COUNT];
-
-    //////////////// INIZIALIZZAZIONE /////////////////
-    // aggiunta all'automa dello stato 0 con il suo kernel
-    struct automa_state state0 = {
-        .items_count = 0,
-        .kernel_items_count = 0,
-        .transition_count = 0,
-        .type = normal
-    };
+    struct stat info;
+    if (stat(path, &info) != 0){
+        return -1;
+    }
 
+    if (S_ISDIR(info.st_mode)){
+        DIR* directory = opendir(path);
+        if (directory == NULL){
+            return -1;
+        }
 
-    // aggiunta dell'item del fresh symbol al kernel dello stato iniziale 0
-    struct lr0_item freshSymbolKernel = {
-        .prod = grammar[0],
-        .marker_position = 0,
-        .isKernelProduction = false
-    };
+        int namesCount = 0, namesCapacity = 16;
+        char** names = arenaAlloc(arena, namesCapacity * sizeof(char*));
+        struct dirent* file;
+        while ((file = readdir(directory)) != NULL){
+            if (file->d_name[0] == '.'){
+                continue;
+            }
+            ensureCapacity(arena, (void**)&names, &namesCapacity, namesCount + 1, sizeof(char*));
+            names[namesCount++] = arenaStrndup(arena, file->d_name, strlen(file->d_name));
+        }
+        closedir(directory);
+        qsort(names, namesCount, sizeof(char*), compareStrings);
 
-    addItemToKernel(&state0, &freshSymbolKernel); 
-    automa[totalStates] = state0;
-    automa[totalStates].items[0].marker_position = 0;  // reset del marker alla posizione 0 in quanto addItemToKernel sposta il marker in avanti di 1
-    totalStates++;
-    
-    /////////////// SVOLGIMENTO //////////////////
-    int unmarkedStateId = 0;
-    while ( unmarkedStateId < totalStates) {   // finche esiste uno stato unmarked
-         
-        // closure del kernel dello stato unmarked (uno stato unmarked contiene solo il kernel)       
-        computeClosure(&automa[unmarkedStateId], grammar, productions_count);
-        
-        for (int i=0; i<automa[unmarkedStateId].items_count; i++){ // aggiunta delle transizioni a partire dagli stati unmarked
-
-            struct lr0_item item = automa[unmarkedStateId].items[i];
-
-            int marker_pos = item.marker_position;
-            if (marker_pos < strlen(item.prod.body) && item.prod.body[marker_pos] != EPSILON){ // se il marker non è in ultima posizione e non e' una transizione tramite epsilon
-                char nextChar = item.prod.body[marker_pos];
-
-                // alreadyAddedStateId conterra' l'id di uno stato gia esistente se per quel nextChar lo stato e' gia stato creato
-                int alreadyAddedStateId = -1;
-                for (int tr=0; tr<automa[unmarkedStateId].transition_count; tr++){
-                    if (nextChar == automa[unmarkedStateId].transitions[tr].by){ // lo stato verso questo carattere e' gia stato inserito
-                        alreadyAddedStateId = automa[unmarkedStateId].transitions[tr].destination; 
-                        break;
-                    }
-                }
+        for (int i=0; i<namesCount; i++){
+            char filePath[4096];
+            if (snprintf(filePath, sizeof(filePath), "%s/%s", path, names[i]) >= (int)sizeof(filePath)){
+                fprintf(stderr, "Percorso troppo lungo, file ignorato: %s/%s\n", path, names[i]);
+                continue;
+            }
+            if (stat(filePath, &info) != 0 || !S_ISREG(info.st_mode)){
+                continue;
+            }
 
+            ensureCapacity(arena, (void**)entries, &capacity, count + 1, sizeof(struct batch_entry));
+            memset(&(*entries)[count], 0, sizeof(struct batch_entry));
+            (*entries)[count].path = arenaStrndup(arena, filePath, strlen(filePath));
+            (*entries)[count].start_symbol = readStartSymbol(filePath, multiCharacter, arena);
+            count++;
+        }
+        return count;
+    }
 
-                int kernelEqualTo = -1;
-                if (alreadyAddedStateId != -1){ // se lo stato destinazione esiste gia allora aggiungo l'item al kernel 
-                    addItemToKernel(&automa[alreadyAddedStateId], &item); 
-                }else if ( (kernelEqualTo = getKernelEqualTo(automa, totalStates, unmarkedStateId, nextChar)) != -1){ // kernel gia presente, aggiungi solo la transizione verso lo stato specificato da kernelEqualTo
+    FILE* manifest = fopen(path, "r");
+    if (manifest == NULL){
+        return -1;
+    }
+    const char* slash = strrchr(path, '/');
+    int directoryLength = slash != NULL ? slash - path + 1 : 0; // cartella del manifest, compresa la '/'
 
-                    struct transition newTransition = {
-                        .from = unmarkedStateId,
-                        .by = item.prod.body[marker_pos],  // il prossimo simbolo
-                        .destination = kernelEqualTo
-                    };
+    char* line = NULL;
+    size_t lineCapacity = 0;
+    while (getline(&line, &lineCapacity, manifest) > 0){
+        char* startSymbol = strtok(line, " \t\r\n");
+        char* file = strtok(NULL, " \t\r\n");
+        if (startSymbol == NULL || file == NULL || startSymbol[0] == '#'){
+            continue;
+        }
+        if (!multiCharacter){ // con simboli di un carattere lo start symbol e' il primo carattere, come da riga di comando
+            startSymbol[1] = '\0';
+        }
 
-                    
-                    printf("Tau (%d, %c) = %d \n", newTransition.from, newTransition.by, newTransition.destination);
-                    automa[unmarkedStateId].transitions[automa[unmarkedStateId].transition_count++] = newTransition;
+        ensureCapacity(arena, (void**)entries, &capacity, count + 1, sizeof(struct batch_entry));
+        struct batch_entry* entry = &(*entries)[count++];
+        memset(entry, 0, sizeof(struct batch_entry));
+        entry->start_symbol = arenaStrndup(arena, startSymbol, strlen(startSymbol));
+        if (file[0] == '/'){
+            entry->path = arenaStrndup(arena, file, strlen(file));
+        }else{
+            entry->path = arenaAlloc(arena, directoryLength + strlen(file) + 1);
+            memcpy(entry->path, path, directoryLength);
+            strcpy(entry->path + directoryLength, file);
+        }
+    }
+    free(line);
+    fclose(manifest);
+    return count;
+}
 
-                }else{ // nuovo stato
+/**
+* Genera l'automa di una grammatica del batch nell'arena del worker e, se richiesto, ne scrive l'output (lo stesso
+* della modalita' normale) nel file <cartella di output>/<nome del file della grammatica>.out
+*/
+void processBatchEntry(struct batch_job* job, struct batch_entry* entry, struct arena* arena){
+    double start = currentTimeSeconds();
 
-                    struct transition newTransition = {
-                        .from = unmarkedStateId,
-                        .by = item.prod.body[marker_pos],  // il prossimo simbolo
-                        .destination = totalStates
-                    };
+    if (entry->start_symbol == NULL){
+        entry->error = "start symbol non trovato";
+        return;
+    }
+    FILE* source = fopen(entry->path, "r");
+    if (source == NULL){
+        entry->error = "file non leggibile";
+        return;
+    }
 
-                    
-                    printf("Tau (%d, %c) = %d \n", newTransition.from, newTransition.by, newTransition.destination);
-                    automa[unmarkedStateId].transitions[automa[unmarkedStateId].transition_count++] = newTransition;
+    struct grammar grammar;
+    struct automa automa;
+    initGrammar(&grammar, arena, job->multi_character);
+    initAutoma(&automa, arena);
+    addFreshProduction(&grammar, entry->start_symbol);
+    readGrammar(&grammar, source, false);
+    fclose(source);
+    updateFreshSymbol(&grammar);
+    finalizeGrammar(&grammar);
 
-                    // creazione e aggiunta del nuovo stato
-                    struct automa_state newState = {
-                        .items_count = 0,
-                        .kernel_items_count = 0,
-                        .transition_count = 0,
-                        .type = normal
-                    };
+    struct conflict_analysis analysis;
+    if (job->check_conflicts){
+        initConflictAnalysis(&analysis, &grammar, job->conflicts_kind, job->fail_fast, arena);
+        automa.conflicts = &analysis;
+    }
 
-                    addItemToKernel(&newState, &item); // aggiunta del kernel al nuovo stato
-                    automa[totalStates++] = newState;
+    entry->productions = grammar.productions_count;
+    entry->states = generateAutomaChar(&automa, &grammar);
+    if (job->check_conflicts){
+        finishConflictAnalysis(&analysis, &automa);
+        entry->conflicts = analysis.conflicts_count;
+        entry->aborted = analysis.aborted;
+    }
 
-                }
+    if (job->output_directory != NULL){
+        const char* slash = strrchr(entry->path, '/');
+        const char* name = slash != NULL ? slash + 1 : entry->path;
+        char* outputPath = arenaAlloc(arena, strlen(job->output_directory) + strlen(name) + 6);
+        sprintf(outputPath, "%s/%s.out", job->output_directory, name);
 
-                
-            }else{ // marker in ultima posizione : reducing item (mark dello stato come stato finale oppure accept)
-                if (item.prod.body[marker_pos - 1] == startSymbol && item.prod.driver==automa[0].items[0].prod.driver){
-                    automa[unmarkedStateId].type = accept;
-                }else{
-                    automa[unmarkedStateId].type = final;
-                }
+        FILE* out = fopen(outputPath, "w");
+        if (out == NULL){
+            entry->error = "file di output non scrivibile";
+        }else{
+            if (!entry->aborted){ // automa incompleto: come per una sola grammatica, vengono scritti solo i conflitti
+                writeAutomaHuman(out, &automa);
+            }
+            if (job->check_conflicts){
+                printConflicts(out, &analysis, &automa);
             }
+            fclose(out);
+        }
+    }
+    entry->seconds = currentTimeSeconds() - start;
+}
+
+void* batchWorkerMain(void* argument){
+    struct batch_worker* worker = argument;
+    struct batch_job* job = worker->job;
 
+    for (;;){
+        int index = atomic_fetch_add(&job->next_entry, 1);
+        if (index >= job->entries_count){
+            break;
         }
+        arenaReset(&worker->arena); // la memoria della grammatica precedente viene riutilizzata
+        processBatchEntry(job, &job->entries[index], &worker->arena);
+    }
+    return NULL;
+}
 
-        unmarkedStateId++;
+/**
+* Genera gli automi di tutte le grammatiche indicate da path (cartella o manifest, vedi collectBatchEntries) con
+* un pool di "threads" worker, ognuno con la propria arena riutilizzata tra una grammatica e l'altra. Su stdout
+* viene scritta una riga JSON per grammatica, nell'ordine dell'elenco, e una riga finale con il throughput.
+* Con checkConflicts ogni grammatica viene validata e quelle con conflitti sono contate come rifiutate.
+*/
+int runBatch(const char* path, const char* outputDirectory, bool multiCharacter, int threads, bool checkConflicts, table_kind conflictsKind, bool failFast){
+    struct arena arena = {0};
+    struct batch_job job;
+    job.output_directory = outputDirectory;
+    job.multi_character = multiCharacter;
+    job.check_conflicts = checkConflicts;
+    job.conflicts_kind = conflictsKind;
+    job.fail_fast = failFast;
+    job.entries_count = collectBatchEntries(path, multiCharacter, &job.entries, &arena);
+    atomic_init(&job.next_entry, 0);
+    if (job.entries_count < 0){
+        printf("Impossibile leggere %s\n", path);
+        arenaFree(&arena);
+        return 1;
+    }
+    if (outputDirectory != NULL){
+        mkdir(outputDirectory, 0755);
+    }
+    if (threads > job.entries_count){
+        threads = job.entries_count > 0 ? job.entries_count : 1;
     }
 
-    return totalStates;
+    // ogni grammatica viene costruita da un solo worker: il parallelismo e' tra grammatiche
+    constructionThreads = 1;
+
+    struct batch_worker* workers = arenaAlloc(&arena, threads * sizeof(struct batch_worker));
+    double start = currentTimeSeconds();
+    for (int w=0; w<threads; w++){
+        memset(&workers[w], 0, sizeof(struct batch_worker));
+        workers[w].job = &job;
+    }
+    // i worker prelevano le grammatiche da job.next_entry: se un thread non puo' essere creato le grammatiche
+    // restanti vengono elaborate da quelli gia' avviati
+    int started = 1; // il thread chiamante fa da worker 0
+    for (int w=1; w<threads; w++){
+        if (pthread_create(&workers[w].thread, NULL, batchWorkerMain, &workers[w]) != 0){
+            fprintf(stderr, "Impossibile creare il thread %d: si prosegue con %d thread\n", w, started);
+            break;
+        }
+        started++;
+    }
+    threads = started;
+    batchWorkerMain(&workers[0]);
+    for (int w=1; w<threads; w++){
+        pthread_join(workers[w].thread, NULL);
+    }
+    double elapsed = currentTimeSeconds() - start;
+
+    int failed = 0, rejected = 0;
+    for (int i=0; i<job.entries_count; i++){
+        struct batch_entry* entry = &job.entries[i];
+        printf("{\"grammar\": ");
+        printJsonString(stdout, entry->path);
+        printf(", \"start\": ");
+        printJsonString(stdout, entry->start_symbol != NULL ? entry->start_symbol : "");
+        if (entry->error != NULL){
+            printf(", \"error\": ");
+            printJsonString(stdout, entry->error);
+            failed++;
+        }
+        printf(", \"productions\": %d, \"states\": %d", entry->productions, entry->states);
+        if (checkConflicts && entry->error == NULL){
+            printf(", \"conflicts\": %d, \"complete\": %s", entry->conflicts, entry->aborted ? "false" : "true");
+            rejected += entry->conflicts > 0;
+        }
+        printf(", \"seconds\": %.6f}\n", entry->seconds);
+    }
+
+    size_t peakBytes = 0;
+    for (int w=0; w<threads; w++){
+        peakBytes += arenaPeakBytes(&workers[w].arena);
+        arenaFree(&workers[w].arena);
+    }
+    printf("{\"grammars\": %d, \"failed\": %d, ", job.entries_count, failed);
+    if (checkConflicts){
+        printf("\"rejected\": %d, ", rejected);
+    }
+    printf("\"threads\": %d, \"wall_seconds\": %.6f, \"grammars_per_second\": %.1f, \"worker_peak_bytes\": %zu}\n",
+        threads, elapsed, elapsed > 0 ? job.entries_count / elapsed : 0, peakBytes);
+
+    arenaFree(&arena);
+    return failed > 0 || rejected > 0 ? 1 : 0;
+}
+
+/**
+* Scrive le statistiche della generazione come oggetto JSON
+*/
+void printStatsJson(FILE* out, struct generation_stats* stats, struct automa* automa, struct arena* arena){
+    long items = 0, transitions = 0;
+    for (int state=0; state<automa->states_count; state++){
+        items += automa->states[state].items_count;
+        transitions += automa->states[state].transition_count;
+    }
 
+    fprintf(out, "{\n");
+    fprintf(out, "  \"threads\": %d,\n", constructionThreads);
+    fprintf(out, "  \"productions\": %d,\n", automa->grammar->productions_count);
+    fprintf(out, "  \"symbols\": %d,\n", automa->grammar->symbols.symbols_count);
+    fprintf(out, "  \"states\": %d,\n", automa->states_count);
+    fprintf(out, "  \"items\": %ld,\n", items);
+    fprintf(out, "  \"transitions\": %ld,\n", transitions);
+    fprintf(out, "  \"peak_bytes\": %zu,\n", arenaPeakBytes(arena));
+    fprintf(out, "  \"cache\": \"%s\",\n", stats->cache != NULL ? stats->cache : "none");
+    fprintf(out, "  \"seconds\": {\n");
+    fprintf(out, "    \"grammar\": %.9f,\n", stats->grammar_seconds);
+    fprintf(out, "    \"construction\": %.9f,\n", stats->construction_seconds);
+    fprintf(out, "    \"closure\": %.9f,\n", stats->closure_seconds);
+    fprintf(out, "    \"kernel_lookup\": %.9f,\n", stats->kernel_lookup_seconds);
+    fprintf(out, "    \"incremental\": %.9f,\n", stats->incremental_seconds);
+    fprintf(out, "    \"output\": %.9f\n", stats->output_seconds);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"counters\": {\n");
+    fprintf(out, "    \"closure_calls\": %ld,\n", stats->closure_calls);
+    fprintf(out, "    \"closure_insertions\": %ld,\n", stats->closure_insertions);
+    fprintf(out, "    \"closure_duplicates\": %ld,\n", stats->closure_duplicates);
+    fprintf(out, "    \"kernel_insertions\": %ld,\n", stats->kernel_insertions);
+    fprintf(out, "    \"kernel_duplicates\": %ld,\n", stats->kernel_duplicates);
+    fprintf(out, "    \"kernel_comparisons\": %ld,\n", stats->kernel_comparisons);
+    fprintf(out, "    \"kernel_lookup_hits\": %ld,\n", stats->kernel_lookup_hits);
+    fprintf(out, "    \"kernel_lookup_misses\": %ld\n", stats->kernel_lookup_misses);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
 }
 
 
 int main(int argc, char** argv){
     FILE* inputSource = stdin;
-    struct production grammar[MAX_GRAMMAR_PRODUCTIONS_NUMBER];
-    
-    char startSymbol;
+    struct arena arena = {0};
+    struct grammar grammar;
+    struct automa automa;
+
+    char* startSymbol;
+    char* positionalArgs[2];
+    int positionalCount = 0;
+    bool printMemory = false;
+    bool multiCharacterSymbols = false;
+    bool printTables = false;
+    bool printSets = false;
+    bool minimizeTables = false;
+    bool lazyConstruction = false;
+    char* profileFile = NULL;
+    char* profileOutput = NULL;
+    table_kind tablesKind = slr_tables;
+    char* parseFile = NULL;
+    char* emitFile = NULL;
+    bool collectStats = false;
+    char* statsFile = NULL;     // con --stats=<file> il JSON viene scritto nel file invece che su stdout
+    char* cacheDirectory = NULL;
+    char* editFile = NULL;
+    char* batchPath = NULL;
+    char* batchOutput = NULL;
+    bool checkConflicts = false;
+    bool failFast = false;
+    table_kind conflictsKind = slr_tables;
+    output_format outputFormat = human_output;
+    char* outputFile = NULL;    // con --output l'automa viene scritto nel file, il resto dell'output resta su stdout
+    bool quietOutput = false;
+
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "--bench-kernel") == 0){
+            return benchKernelLookup();
+        }else if (strcmp(argv[i], "--bench-parser") == 0){
+            return benchParser();
+        }else if (strcmp(argv[i], "--bench-scaling") == 0){
+            return benchScaling(argc - i - 1, argv + i + 1);
+        }else if (strcmp(argv[i], "--bench-sets") == 0){
+            return benchGrammarSets(argc - i - 1, argv + i + 1);
+        }else if (strcmp(argv[i], "--bench-lalr") == 0){
+            return benchLalr(argc - i - 1, argv + i + 1);
+        }else if (strcmp(argv[i], "--synthetic-grammar") == 0){
+            return writeSyntheticGrammars(argc - i - 1, argv + i + 1);
+        }else if (strcmp(argv[i], "--bench-direct") == 0){
+            return benchDirectParser();
+        }else if (strcmp(argv[i], "--test-incremental") == 0){
+            return testIncremental();
+        }else if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc){
+            emitFile = argv[++i];
+        }else if (strcmp(argv[i], "--parse") == 0 && i + 1 < argc){
+            parseFile = argv[++i];
+        }else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            constructionThreads = atoi(argv[++i]);
+            if (constructionThreads < 1){
+                constructionThreads = 1;
+            }
+        }else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc){
+            batchPath = argv[++i];
+        }else if (strcmp(argv[i], "--batch-output") == 0 && i + 1 < argc){
+            batchOutput = argv[++i];
+        }else if (strcmp(argv[i], "--edit") == 0 && i + 1 < argc){
+            editFile = argv[++i];
+        }else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc){
+            cacheDirectory = argv[++i];
+        }else if (strcmp(argv[i], "--stats") == 0){
+            collectStats = true;
+        }else if (strncmp(argv[i], "--stats=", 8) == 0){
+            collectStats = true;
+            statsFile = argv[i] + 8;
+        }else if (strcmp(argv[i], "--conflicts") == 0 || strcmp(argv[i], "--conflicts=slr") == 0){
+            checkConflicts = true;
+            conflictsKind = slr_tables;
+        }else if (strcmp(argv[i], "--conflicts=lr0") == 0){
+            checkConflicts = true;
+            conflictsKind = lr0_tables;
+        }else if (strcmp(argv[i], "--conflicts=lalr") == 0){
+            checkConflicts = true;
+            conflictsKind = lalr_tables;
+        }else if (strcmp(argv[i], "--fail-fast") == 0){
+            checkConflicts = true;
+            failFast = true;
+        }else if (strcmp(argv[i], "--sets") == 0){
+            printSets = true;
+        }else if (strcmp(argv[i], "--minimize") == 0){
+            minimizeTables = true;
+        }else if (strcmp(argv[i], "--lazy") == 0){
+            lazyConstruction = true;
+        }else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc){
+            profileFile = argv[++i];
+        }else if (strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc){
+            profileOutput = argv[++i];
+        }else if (strcmp(argv[i], "--format=human") == 0){
+            outputFormat = human_output;
+        }else if (strcmp(argv[i], "--format=json") == 0){
+            outputFormat = json_output;
+        }else if (strcmp(argv[i], "--format=dot") == 0){
+            outputFormat = dot_output;
+        }else if (strcmp(argv[i], "--format=binary") == 0){
+            outputFormat = binary_output;
+        }else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc){
+            outputFile = argv[++i];
+        }else if (strcmp(argv[i], "--quiet") == 0){
+            quietOutput = true;
+        }else if (strcmp(argv[i], "--memory") == 0){
+            printMemory = true;
+        }else if (strcmp(argv[i], "--multichar") == 0){
+            multiCharacterSymbols = true;
+        }else if (strcmp(argv[i], "--tables") == 0 || strcmp(argv[i], "--tables=slr") == 0){
+            printTables = true;
+            tablesKind = slr_tables;
+        }else if (strcmp(argv[i], "--tables=lr0") == 0){
+            printTables = true;
+            tablesKind = lr0_tables;
+        }else if (strcmp(argv[i], "--tables=lalr") == 0){
+            printTables = true;
+            tablesKind = lalr_tables;
+        }else if (positionalCount < 2){
+            positionalArgs[positionalCount++] = argv[i];
+        }
+    }
 
-    char new_production[PRODUCTION_LENGTH];
-    int productions_count = 0;
-    int totalStates;
+    if (batchPath != NULL){
+        return runBatch(batchPath, batchOutput, multiCharacterSymbols, constructionThreads, checkConflicts, conflictsKind, failFast);
+    }
 
-    if (argc < 2) {
-        printf("Use %s <start_symbol> <grammar_file>\n", argv[0]);
+    if (positionalCount < 1) {
+        printf("Use %s [-j N] [--quiet] [--format=human|json|dot|binary] [--output <file>] [--memory] [--stats[=<file>]] [--cache <dir>] [--edit <diff_file>] [--multichar] [--conflicts[=lr0|slr|lalr]] [--fail-fast] [--sets] [--tables[=lr0|slr|lalr]] [--minimize] [--parse <input_file>|-] [--emit-c <file.c>] <start_symbol> <grammar_file>\n", argv[0]);
+        printf("    %s [--multichar] [--tables[=lr0|slr]] --lazy [--profile <file>] [--profile-out <file>] --parse <input_file>|- <start_symbol> <grammar_file>\n", argv[0]);
+        printf("    %s [-j N] [--multichar] [--conflicts[=lr0|slr|lalr]] [--fail-fast] --batch <dir|manifest> [--batch-output <dir>]\n", argv[0]);
+        printf("    %s --bench-kernel | --bench-parser | --bench-direct | --test-incremental\n", argv[0]);
+        printf("    %s [-j N] --bench-scaling | --bench-sets | --bench-lalr | --synthetic-grammar [chiave=valore ...]\n", argv[0]);
         exit(0);
     }
-    startSymbol = argv[1][0];
-    
-    if (argc == 3){ // file della grammatica in input
-        inputSource = fopen(argv[2], "r");
+    if (lazyConstruction && (parseFile == NULL || tablesKind == lalr_tables)){
+        printf("--lazy richiede --parse e tabelle lr0 o slr: i lookahead LALR(1) dipendono dall'intero automa\n");
+        exit(1);
+    }
+    startSymbol = positionalArgs[0];
+    if (!multiCharacterSymbols && startSymbol[0] != '\0'){ // con simboli di un carattere lo start symbol e' il primo carattere del parametro
+        startSymbol[1] = '\0';
+    }
+
+    if (positionalCount == 2){ // file della grammatica in input
+        inputSource = fopen(positionalArgs[1], "r");
+        if (inputSource == NULL){
+            fprintf(stderr, "Impossibile aprire il file %s: %s\n", positionalArgs[1], strerror(errno));
+            exit(1);
+        }
+    }
+
+    // l'automa viene scritto solo a costruzione terminata, attraverso uno stream con un buffer ampio
+    FILE* output = stdout;
+    if (outputFile != NULL && !quietOutput){
+        output = fopen(outputFile, outputFormat == binary_output ? "wb" : "w");
+        if (output == NULL){
+            fprintf(stderr, "Impossibile scrivere il file %s: %s\n", outputFile, strerror(errno));
+            exit(1);
+        }
     }
+    setvbuf(output, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    // resoconti delle altre opzioni (--edit, conflitti, insiemi, tabelle, parsing, memoria, statistiche): su stdout,
+    // oppure su stderr se stdout contiene l'automa in un formato diverso da human
+    FILE* report = outputFormat != human_output && output == stdout && !quietOutput ? stderr : stdout;
+
+    initGrammar(&grammar, &arena, multiCharacterSymbols);
+    initAutoma(&automa, &arena);
 
     // estendi la grammatica P a P' : grammatica con aggiunta la produzione K -> startSymbol. K deve essere un fresh symbol.
     // Si controlla che K sia un fresh symbol utilizzando la funzione updateFreshSymbol dopo aver letto tutte le produzioni possibili.
-    char fresh_production[] = "K -> _";
-    fresh_production[5] = startSymbol;
-    addProduction(grammar, fresh_production, &productions_count);
+    double grammarStart = collectStats ? currentTimeSeconds() : 0;
+    addFreshProduction(&grammar, startSymbol);
 
-    // leggo le produzioni una ad una
-    while (fgets(new_production, PRODUCTION_LENGTH, inputSource) && new_production[0] != '\n'){
-        // rimuovo il carattere newline
-        if (new_production[strlen(new_production) - 1] == '\n')
-            new_production[strlen(new_production) - 1] = '\0';  
+    readGrammar(&grammar, inputSource, true);
 
-        if (addProduction(grammar, new_production, &productions_count) == false){ 
-            printf("La produzione %s non e' stata inserita in quanto non rispetta lo standard: A -> beta\n", new_production);
-        }
+    updateFreshSymbol(&grammar);
+    finalizeGrammar(&grammar);
+    if (collectStats){
+        generationStats.grammar_seconds = currentTimeSeconds() - grammarStart;
+        automa.stats = &generationStats;
+    }
 
+    ////////////////////////// COSTRUZIONE LAZY //////////////////////////
+    // con --lazy l'automa non viene costruito: gli stati vengono creati dal parser quando li raggiunge
+    if (lazyConstruction){
+        if (!quietOutput && outputFormat == human_output){
+            fprintf(output, "Il nuovo fresh Symbol e': %s\n", symbolName(&grammar, grammar.productions[0].driver));
+            printGrammar(output, &grammar);
+            fflush(output);
+        }
+        runLazyParse(&automa, &grammar, tablesKind, parseFile, profileFile, profileOutput, &arena);
+        arenaFree(&arena);
+        return 0;
     }
 
-    updateFreshSymbol(grammar, productions_count);
+    ////////////////////// AGGIORNAMENTO INCREMENTALE //////////////////////
+    // con --edit l'automa della grammatica letta viene costruito e poi aggiornato con le modifiche
+    if (editFile != NULL){
+        FILE* editSource = fopen(editFile, "r");
+        if (editSource == NULL){
+            printf("Impossibile aprire il file %s\n", editFile);
+            exit(1);
+        }
+
+        double constructionStart = collectStats ? currentTimeSeconds() : 0;
+        if (cacheDirectory != NULL){
+            generateAutomaCached(&automa, &grammar, cacheDirectory);
+        }else{
+            generateAutomaChar(&automa, &grammar);
+        }
+
+        struct grammar_diff diff;
+        struct incremental_report incremental;
+        double incrementalStart = collectStats ? currentTimeSeconds() : 0;
+        applyGrammarDiff(&grammar, editSource, report, &diff);
+        updateAutomaIncremental(&automa, &diff, &incremental);
+        if (collectStats){
+            generationStats.construction_seconds = incrementalStart - constructionStart;
+            generationStats.incremental_seconds = currentTimeSeconds() - incrementalStart;
+        }
+        fclose(editSource);
 
-    /////////////////////// STAMPA PRODUZIONI LETTE ///////////////////////
-    printf("============== GRAMMATICA ===============\n");
-    for (int i=0; i<productions_count; i++){
-        printf("%c -> %s\n", grammar[i].driver, grammar[i].body);
+        fprintf(report, "Modifiche applicate: %d produzioni aggiunte, %d rimosse\n", diff.added, diff.removed);
+        fprintf(report, "Stati ricostruiti: %d, nuovi: %d, eliminati: %d, rinumerati: %d\n", incremental.rebuilt_states, incremental.new_states, incremental.removed_states, incremental.renumbered_states);
     }
 
     ////////////////////////// CREAZIONE AUTOMA //////////////////////////
 
-    printf("============== TRANSIZIONI ==============\n");
-    struct automa_state automa[MAX_AUTOMA_STATES_COUNT];
-    totalStates = generateAutomaChar(automa, grammar, productions_count, startSymbol);
+    // con LR(0) e SLR i conflitti vengono controllati durante la costruzione, stato per stato
+    struct conflict_analysis analysis;
+    if (checkConflicts){
+        initConflictAnalysis(&analysis, &grammar, conflictsKind, failFast, &arena);
+        automa.conflicts = &analysis;
+    }
+
+    if (editFile == NULL){
+        double constructionStart = collectStats ? currentTimeSeconds() : 0;
+        if (cacheDirectory != NULL){
+            generateAutomaCached(&automa, &grammar, cacheDirectory);
+        }else{
+            generateAutomaChar(&automa, &grammar);
+        }
+        if (collectStats){
+            generationStats.construction_seconds = currentTimeSeconds() - constructionStart;
+        }
+    }
 
+    if (checkConflicts){
+        finishConflictAnalysis(&analysis, &automa);
+        if (analysis.aborted){ // automa incompleto: vengono riportati solo i conflitti
+            printConflicts(report, &analysis, &automa);
+            if (output != stdout){
+                fclose(output);
+            }
+            releaseAutomaCache(&automa);
+            arenaFree(&arena);
+            return 1;
+        }
+    }
 
     /////////////////////////////// STAMPA //////////////////////////////
-    printf("=========== ITEMS NEGLI STATI ===========\n");
-    for(int state=0; state<totalStates; state++){
-        char* state_type = "";
-        if (automa[state].type == accept){
-            state_type = "Stato di accept";
-        }else if(automa[state].type == final){
-            state_type = "Stato finale";
+    if (!quietOutput){
+        double outputStart = collectStats ? currentTimeSeconds() : 0;
+        if (!writeAutoma(output, &automa, outputFormat)){
+            fprintf(stderr, "Impossibile scrivere l'automa\n");
+        }
+        if (output != stdout){
+            fclose(output);
+        }
+        if (collectStats){
+            generationStats.output_seconds = currentTimeSeconds() - outputStart;
+        }
+    }
+
+    if (checkConflicts){
+        printConflicts(report, &analysis, &automa);
+    }
+
+    if (printSets){
+        struct grammar_sets sets;
+        computeGrammarSets(&grammar, &sets, &arena);
+        printGrammarSets(report, &sets, &grammar);
+    }
+
+    // con --minimize le tabelle usate da --tables, --emit-c e --parse sono quelle ottimizzate
+    struct table_optimization optimization;
+    if (minimizeTables){
+        struct parse_tables tables;
+        buildParseTables(&tables, &automa, tablesKind, &arena);
+        optimizeParseTables(&tables, &arena, &optimization);
+        printTableOptimization(report, &optimization);
+    }
+
+    if (printTables){
+        struct parse_tables tables;
+        buildParseTables(&tables, &automa, tablesKind, &arena);
+        if (minimizeTables){
+            optimizeParseTables(&tables, &arena, &optimization);
+        }
+        printParseTables(report, &tables, &grammar);
+    }
+
+    if (emitFile != NULL){
+        FILE* out = fopen(emitFile, "w");
+        if (out == NULL){
+            fprintf(report, "Impossibile scrivere il file %s\n", emitFile);
+        }else{
+            struct parse_tables tables;
+            buildParseTables(&tables, &automa, tablesKind, &arena);
+            if (minimizeTables){
+                optimizeParseTables(&tables, &arena, &optimization);
+            }
+            emitDirectParser(out, &tables, &grammar);
+            fclose(out);
         }
+    }
 
-        printf("++++++++++ STATO %d %s\n", state, state_type);
-        for(int itemId = 0; itemId < automa[state].items_count; itemId++){
-            struct lr0_item* item = &automa[state].items[itemId];
-            printf("%c -> ", item->prod.driver);
-            if (item->prod.body[0] == EPSILON){
-                printf(".");
+    if (parseFile != NULL){ // con "-" l'input e' letto da stdin (dopo la riga vuota che termina la grammatica, se letta da stdin)
+        FILE* parseSource = strcmp(parseFile, "-") == 0 ? stdin : fopen(parseFile, "r");
+        if (parseSource == NULL){
+            fprintf(report, "Impossibile aprire il file %s\n", parseFile);
+        }else{
+            struct parse_tables tables;
+            struct lr_parser parser;
+            struct token_reader* reader = arenaAlloc(&arena, sizeof(struct token_reader));
+
+            buildParseTables(&tables, &automa, tablesKind, &arena);
+            if (minimizeTables){
+                optimizeParseTables(&tables, &arena, &optimization);
+            }
+            initParser(&parser, &tables, &grammar, &arena);
+            initTokenReader(reader, &grammar, &arena);
+            setTokenSource(reader, parseSource);
+
+            fprintf(report, "================ PARSING ================\n");
+            if (parseInput(&parser, reader)){
+                fprintf(report, "Input accettato (%ld token)\n", reader->tokens_read);
             }else{
-                for (int t=0; t<strlen(item->prod.body); t++){
-                    if (t == item->marker_position){
-                        printf(".%c",item->prod.body[t]);
-                    }else{
-                        printf("%c",item->prod.body[t]);
-                    }
-                }
+                fprintf(report, "Errore di sintassi al token %ld\n", reader->tokens_read);
             }
-            
-            if (item->marker_position == strlen(item->prod.body)){ // marker in ultima posizione
-                printf(".");
+            if (parseSource != stdin){
+                fclose(parseSource);
             }
+        }
+    }
 
-            if (item->isKernelProduction){ // item facente parte del kernel
-                if (strlen(item->prod.body) == 1)
-                    printf("\t");
-                printf("\t[ K ]");
+    if (printMemory){
+        fprintf(report, "Memoria di picco: %zu byte (%zu byte utilizzati)\n", arenaPeakBytes(&arena), arena.used_bytes);
+    }
+
+    if (collectStats){
+        FILE* statsOut = statsFile != NULL ? fopen(statsFile, "w") : report;
+        if (statsOut == NULL){
+            fprintf(report, "Impossibile scrivere il file %s\n", statsFile);
+        }else{
+            printStatsJson(statsOut, &generationStats, &automa, &arena);
+            if (statsOut != report){
+                fclose(statsOut);
             }
-            
-            printf("\n");
         }
-        
     }
-            
-    return(0);
+
+    releaseAutomaCache(&automa);
+    arenaFree(&arena);
+    return checkConflicts && analysis.conflicts_count > 0 ? 1 : 0;
 }